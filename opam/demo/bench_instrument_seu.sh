@@ -0,0 +1,50 @@
+#!/bin/bash
+
+#Times instrument_seu on synthetic translation units of growing size, to check that instrumenting a merged,
+#whole-project CIL file scales linearly with its size.
+#Usage: bench_instrument_seu.sh [lines ...]		(default: 1000 10000 100000)
+
+sizes=("$@")
+[ ${#sizes[@]} -eq 0 ] && sizes=(1000 10000 100000)
+block_lines=1000							#Statements per generated function, 0 puts everything in one instruction block.
+bench_dir="/home/opam/demo/bench_instrument"				#Generated inputs, instrumented outputs and results.
+target_var="x"								#Variable instrumented in every generated function.
+
+mkdir -p "${bench_dir}"
+ocamlfind ocamlopt -package cil -linkpkg -o instrument_seu /home/opam/demo/instrument_seu.ml > /dev/null 2>&1
+
+#Writes a C file of about $1 lines: functions of block_lines straight-line statements, each one reading and writing
+#the target variable, so that nearly every instruction gets an SEU call.
+generate() {
+	local lines="$1" out="$2"
+	local per=$(( block_lines > 0 ? block_lines : lines ))
+	awk -v lines="$lines" -v per="$per" -v var="$target_var" '
+	  BEGIN {
+	    f = 0
+	    for (n = 0; n < lines; ) {
+	      printf "int f%d(int a) {\n    int %s = a;\n    int y = 0;\n", f, var
+	      for (k = 0; k < per && n < lines; k++) {
+		if (k % 3 == 0)      printf "    y = y + %s * %d;\n", var, k
+		else if (k % 3 == 1) printf "    %s = y - %d;\n", var, k
+		else                 printf "    y = (y ^ %s) + a;\n", var
+		n++
+	      }
+	      printf "    return y;\n}\n\n"
+	      f++
+	    }
+	    printf "int main(void) {\n    return f0(1);\n}\n"
+	  }
+	' > "$out"
+}
+
+results="${bench_dir}/results.txt"
+printf "%10s %12s %10s\n" "lines" "seconds" "us/line" | tee "$results"
+for lines in "${sizes[@]}"; do
+	input="${bench_dir}/synthetic_${lines}.c"
+	generate "$lines" "$input"
+	start=$(date +%s.%N)
+	./instrument_seu "$input" "${bench_dir}/synthetic_${lines}_instru.c" "$target_var" > /dev/null 2>&1 || echo "[-] instrument_seu failed on ${input}"
+	end=$(date +%s.%N)
+	awk -v l="$lines" -v s="$start" -v e="$end" 'BEGIN { printf "%10d %12.3f %10.2f\n", l, e - s, (e - s) * 1e6 / l }' | tee -a "$results"
+done
+echo "[+] Results written to: ${results}"
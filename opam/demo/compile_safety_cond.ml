@@ -0,0 +1,839 @@
+open Cil
+open Pretty
+module E = Errormsg
+
+module StringSet = Set.Make(String)
+
+(* -------------------------------------------------- *)
+(* Safety condition file                              *)
+(* -------------------------------------------------- *)
+
+(* One invariant per line: "<name>: <C expression>", over the variables in
+   scope at the call of the entry function in main. Empty lines and lines
+   starting with '#' are skipped. *)
+type condition = { cname : string; cexpr : string; cline : int }
+
+let read_lines (path : string) : string list =
+  let ic = open_in path in
+  let rec loop acc =
+    match (try Some (input_line ic) with End_of_file -> None) with
+    | Some l -> loop (l :: acc)
+    | None -> close_in ic; List.rev acc
+  in
+  loop []
+
+let is_ident_start c =
+  (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c = '_'
+
+let is_ident_char c = is_ident_start c || (c >= '0' && c <= '9')
+
+let is_ident (s : string) : bool =
+  let ok = ref (String.length s > 0 && is_ident_start s.[0]) in
+  String.iter (fun c -> if not (is_ident_char c) then ok := false) s;
+  !ok
+
+let parse_conditions (path : string) : condition list =
+  let conds = ref [] in
+  List.iteri (fun idx raw ->
+    let l = String.trim raw in
+    if l <> "" && l.[0] <> '#' then begin
+      let colon =
+        try String.index l ':'
+        with Not_found ->
+          Printf.eprintf "%s:%d: expected \"<name>: <expression>\"\n" path (idx + 1);
+          exit 1
+      in
+      let name = String.trim (String.sub l 0 colon) in
+      let expr = String.trim (String.sub l (colon + 1) (String.length l - colon - 1)) in
+      if not (is_ident name) || expr = "" then begin
+        Printf.eprintf "%s:%d: expected \"<name>: <expression>\"\n" path (idx + 1);
+        exit 1
+      end;
+      conds := { cname = name; cexpr = expr; cline = idx + 1 } :: !conds
+    end
+  ) (read_lines path);
+  List.rev !conds
+
+(* -------------------------------------------------- *)
+(* Expression tokens                                  *)
+(* -------------------------------------------------- *)
+
+type token = Ident of string | Text of string
+
+let tokenize (s : string) : token list =
+  let n = String.length s in
+  let rec go i acc =
+    if i >= n then List.rev acc
+    else if is_ident_start s.[i] then begin
+      let j = ref i in
+      while !j < n && is_ident_char s.[!j] do incr j done;
+      go !j (Ident (String.sub s i (!j - i)) :: acc)
+    end else if s.[i] >= '0' && s.[i] <= '9' then begin
+      (* Numbers, suffixes included (1.5f, 0x1F), are not identifiers *)
+      let j = ref i in
+      while !j < n && (is_ident_char s.[!j] || s.[!j] = '.') do incr j done;
+      go !j (Text (String.sub s i (!j - i)) :: acc)
+    end else
+      go (i + 1) (Text (String.make 1 s.[i]) :: acc)
+  in
+  go 0 []
+
+(* Rebuilds the expression, passing every identifier through f. The flag
+   tells whether the identifier is a member name (after '.' or '->'). *)
+let map_idents (f : bool -> string -> string) (toks : token list) : string =
+  let buf = Buffer.create 64 in
+  let prev1 = ref "" and prev2 = ref "" in
+  let push t = prev2 := !prev1; prev1 := t in
+  List.iter (function
+    | Ident id ->
+        let member = !prev1 = "." || (!prev1 = ">" && !prev2 = "-") in
+        Buffer.add_string buf (f member id);
+        push id
+    | Text t ->
+        Buffer.add_string buf t;
+        if String.trim t <> "" then push t
+  ) toks;
+  Buffer.contents buf
+
+let free_idents (toks : token list) : string list =
+  let ids = ref [] in
+  ignore (map_idents (fun member id ->
+    if not member then ids := id :: !ids;
+    id) toks);
+  List.rev !ids
+
+(* -------------------------------------------------- *)
+(* Temporal monitors                                  *)
+(* -------------------------------------------------- *)
+
+(* consecutive(n, cond), increasing(n, value) and decreasing(n, value) in a
+   condition are compiled into the constant-state monitors of
+   temporal_monitor.h, stepped once each time the properties are checked.
+   increasing/decreasing start as the float monitor and get the variant of
+   their value's type once the symbols of the harness are known. *)
+type monitor = {
+  mname : string;
+  mtype : string;
+  mstep : string;
+  mdepth : string;
+  marg : string;
+}
+
+let monitor_kinds =
+  [ ("consecutive", ("ConsecutiveMonitor", "consecutive_step"));
+    ("increasing", ("MonotonicMonitor", "increasing_step"));
+    ("decreasing", ("MonotonicMonitor", "decreasing_step")) ]
+
+let monitors : monitor list ref = ref []
+
+let is_blank = function
+  | Text t -> String.trim t = ""
+  | Ident _ -> false
+
+let tokens_to_string (toks : token list) : string = map_idents (fun _ id -> id) toks
+
+(* Replaces every monitor application by the name of its output. Inner
+   applications are numbered first, so stepping in order is bottom-up. *)
+let rec extract_monitors (where : string) (toks : token list) : token list =
+  let a = Array.of_list toks in
+  let n = Array.length a in
+  let out = ref [] in
+  let i = ref 0 in
+  while !i < n do
+    (match a.(!i) with
+     | Ident kind when List.mem_assoc kind monitor_kinds ->
+         let j = ref (!i + 1) in
+         while !j < n && is_blank a.(!j) do incr j done;
+         if !j < n && a.(!j) = Text "(" then begin
+           (* Matching parenthesis, and the comma between the two arguments *)
+           let depth = ref 1 and comma = ref (-1) and close = ref (!j + 1) in
+           while !close < n && !depth > 0 do
+             (match a.(!close) with
+              | Text "(" -> incr depth
+              | Text ")" -> decr depth
+              | Text "," when !depth = 1 && !comma < 0 -> comma := !close
+              | _ -> ());
+             if !depth > 0 then incr close
+           done;
+           if !close >= n || !comma < 0 then begin
+             Printf.eprintf "%s: expected %s(<n>, <expression>)\n" where kind;
+             exit 1
+           end;
+           let sub lo hi = Array.to_list (Array.sub a lo (hi - lo)) in
+           let arg = extract_monitors where (sub (!comma + 1) !close) in
+           let (mtype, mstep) = List.assoc kind monitor_kinds in
+           let name = Printf.sprintf "seu_mon_%d" (List.length !monitors) in
+           monitors := !monitors @ [{
+             mname = name; mtype = mtype; mstep = mstep;
+             mdepth = String.trim (tokens_to_string (sub (!j + 1) !comma));
+             marg = String.trim (tokens_to_string arg) }];
+           out := Ident name :: !out;
+           i := !close + 1
+         end else begin
+           out := a.(!i) :: !out;
+           incr i
+         end
+     | t ->
+         out := t :: !out;
+         incr i)
+  done;
+  List.rev !out
+
+(* -------------------------------------------------- *)
+(* Symbols of the harness                             *)
+(* -------------------------------------------------- *)
+
+let c_words =
+  List.fold_left (fun acc w -> StringSet.add w acc) StringSet.empty
+    ["sizeof"; "true"; "false"; "NULL"; "int"; "unsigned"; "signed"; "char";
+     "short"; "long"; "float"; "double"; "bool"; "_Bool"; "const"; "volatile";
+     "struct"; "union"; "enum"]
+
+(* Names introduced with #define in the harness source itself *)
+let defined_macros (lines : string list) : StringSet.t =
+  List.fold_left (fun acc raw ->
+    let l = String.trim raw in
+    if String.length l > 1 && l.[0] = '#' then begin
+      let toks = tokenize (String.sub l 1 (String.length l - 1)) in
+      let words = List.filter (function Text t -> String.trim t <> "" | _ -> true) toks in
+      match words with
+      | Ident "define" :: Ident name :: _ -> StringSet.add name acc
+      | _ -> acc
+    end else acc
+  ) StringSet.empty lines
+
+(* Integer value of a "#define NAME <integer>" of the harness source *)
+let macro_int (lines : string list) (name : string) : int option =
+  List.fold_left (fun acc raw ->
+    let l = String.trim raw in
+    if String.length l > 1 && l.[0] = '#' then begin
+      let toks = tokenize (String.sub l 1 (String.length l - 1)) in
+      let words = List.filter (function Text t -> String.trim t <> "" | _ -> true) toks in
+      match words with
+      | Ident "define" :: Ident n :: Text v :: ([] | [Text "/"] | Text "/" :: Text "/" :: _ | Text "/" :: Text "*" :: _)
+        when n = name -> (try Some (int_of_string v) with Failure _ -> acc)
+      | _ -> acc
+    end else acc
+  ) None lines
+
+let global_symbols (file : file) : StringSet.t =
+  List.fold_left (fun acc g ->
+    match g with
+    | GVar (vi, _, _) | GVarDecl (vi, _) -> StringSet.add vi.vname acc
+    | GFun (fd, _) -> StringSet.add fd.svar.vname acc
+    | GType (ti, _) -> StringSet.add ti.tname acc
+    | GEnumTag (ei, _) ->
+        List.fold_left (fun acc (n, _, _) -> StringSet.add n acc) acc ei.eitems
+    | _ -> acc
+  ) StringSet.empty file.globals
+
+(* -------------------------------------------------- *)
+(* Call site of the entry function in main            *)
+(* -------------------------------------------------- *)
+
+type site = {
+  call_line : int;            (* line of the call (or of CIL's copy out of its temporary) *)
+  lhs : lval option;
+  args : exp list;
+  after_call : instr list;    (* rest of the same instruction list *)
+  later : stmt list;          (* statements after it in the same block *)
+  in_loop : bool;
+}
+
+let is_entry_call (entry : string) (i : instr) : bool =
+  match i with
+  | Call (_, Lval (Var vi, NoOffset), _, _) -> vi.vname = entry
+  | _ -> false
+
+let rec split_at_call (entry : string) (il : instr list) : (instr * instr list) option =
+  match il with
+  | [] -> None
+  | i :: rest when is_entry_call entry i -> Some (i, rest)
+  | _ :: rest -> split_at_call entry rest
+
+let make_site (i : instr) (after : instr list) (later : stmt list) (in_loop : bool) : site =
+  match i with
+  | Call (lhs, _, args, loc) ->
+      (* CIL may return through a temporary: "tmp = p(x); output = tmp;" *)
+      (match lhs, after with
+       | Some (Var tmp, NoOffset),
+         Set (lv, (Lval (Var t, NoOffset) | CastE (_, Lval (Var t, NoOffset))), sloc) :: after'
+         when t == tmp ->
+           { call_line = sloc.line; lhs = Some lv; args = args;
+             after_call = after'; later = later; in_loop = in_loop }
+       | _ ->
+           { call_line = loc.line; lhs = lhs; args = args;
+             after_call = after; later = later; in_loop = in_loop })
+  | _ -> assert false
+
+let rec find_site (entry : string) (in_loop : bool) (stmts : stmt list) : site option =
+  match stmts with
+  | [] -> None
+  | s :: rest ->
+      let here =
+        match s.skind with
+        | Instr il ->
+            (match split_at_call entry il with
+             | Some (i, after) -> Some (make_site i after rest in_loop)
+             | None -> None)
+        | If (_, b1, b2, _) ->
+            (match find_site entry in_loop b1.bstmts with
+             | Some _ as r -> r
+             | None -> find_site entry in_loop b2.bstmts)
+        | Loop (b, _, _, _) -> find_site entry true b.bstmts
+        | Block b | Switch (_, b, _, _) -> find_site entry in_loop b.bstmts
+        | _ -> None
+      in
+      match here with
+      | Some _ -> here
+      | None -> find_site entry in_loop rest
+
+(* Whether an instruction or statement writes one of the named variables *)
+class writesVisitor (names : StringSet.t) (hit : bool ref) = object
+  inherit nopCilVisitor
+  method vinst i =
+    let root = function
+      | (Var vi, _) -> StringSet.mem vi.vname names
+      | _ -> false
+    in
+    (match i with
+     | Set (lv, _, _) when root lv -> hit := true
+     | Call (Some lv, _, _, _) when root lv -> hit := true
+     | Call (_, _, args, _) ->
+         if List.exists (function AddrOf lv | StartOf lv -> root lv | _ -> false) args
+         then hit := true
+     | _ -> ());
+    SkipChildren
+end
+
+let instr_writes names i =
+  let hit = ref false in
+  ignore (visitCilInstr (new writesVisitor names hit) i);
+  !hit
+
+let stmt_writes names s =
+  let hit = ref false in
+  ignore (visitCilStmt (new writesVisitor names hit) s);
+  !hit
+
+let last_matching (p : 'a -> bool) (l : 'a list) : (int * 'a) option =
+  let rec go idx best = function
+    | [] -> best
+    | x :: rest -> go (idx + 1) (if p x then Some (idx, x) else best) rest
+  in
+  go 0 None l
+
+(* -------------------------------------------------- *)
+(* Globals of the primed side                         *)
+(* -------------------------------------------------- *)
+
+(* The primed functions run on their own copies "<g>_prime" of the program's globals (instrument_seu -prime
+   declares them extern): the ones defined in the harness source itself, not in the headers it includes. *)
+let source_globals (file : file) (harness_c : string) : (varinfo * initinfo) list =
+  List.fold_left (fun acc g ->
+    match g with
+    | GVar (vi, init, loc)
+      when loc.file = harness_c && not (String.length vi.vname >= 2 && String.sub vi.vname 0 2 = "__") ->
+        acc @ [(vi, init)]
+    | _ -> acc
+  ) [] file.globals
+
+(* Globals each function writes, itself or through its callees: assigned, or passed by address *)
+class globalWritesVisitor (names : StringSet.t) (written : StringSet.t ref) (callees : string list ref) = object
+  inherit nopCilVisitor
+  method vinst i =
+    let note = function
+      | (Var vi, _) when vi.vglob && StringSet.mem vi.vname names -> written := StringSet.add vi.vname !written
+      | _ -> ()
+    in
+    (match i with
+     | Set (lv, _, _) -> note lv
+     | Call (lhs, fn, args, _) ->
+         (match lhs with Some lv -> note lv | None -> ());
+         List.iter (function AddrOf lv | StartOf lv -> note lv | _ -> ()) args;
+         (match fn with Lval (Var f, NoOffset) -> callees := f.vname :: !callees | _ -> ())
+     | _ -> ());
+    SkipChildren
+end
+
+let global_writes (file : file) (names : StringSet.t) : (string, StringSet.t) Hashtbl.t =
+  let direct = Hashtbl.create 16 and calls = Hashtbl.create 16 in
+  iterGlobals file (function
+    | GFun (fd, _) ->
+        let written = ref StringSet.empty and callees = ref [] in
+        ignore (visitCilFunction (new globalWritesVisitor names written callees) fd);
+        Hashtbl.replace direct fd.svar.vname !written;
+        Hashtbl.replace calls fd.svar.vname !callees
+    | _ -> ());
+  let total = Hashtbl.copy direct in
+  let changed = ref true in
+  while !changed do
+    changed := false;
+    Hashtbl.iter (fun f callees ->
+      let w = Hashtbl.find total f in
+      let w' =
+        List.fold_left (fun acc c -> try StringSet.union acc (Hashtbl.find total c) with Not_found -> acc) w callees
+      in
+      if not (StringSet.equal w w') then begin
+        Hashtbl.replace total f w';
+        changed := true
+      end
+    ) calls
+  done;
+  total
+
+(* Fields of a variable that the conditions read: Some fields when it only appears as v.f, None when
+   it is also used as a whole *)
+let fields_of (name : string) (conds : condition list) : string list option =
+  let rec go prev prev2 acc = function
+    | [] -> acc
+    | Ident id :: rest when id <> name || prev = "." || (prev = ">" && prev2 = "-") -> go id prev acc rest
+    | Ident _ :: Text "." :: Ident f :: rest ->
+        go f "." (match acc with Some l -> Some (if List.mem f l then l else l @ [f]) | None -> None) rest
+    | Ident id :: rest -> go id prev None rest
+    | Text t :: rest -> go t prev acc rest
+  in
+  List.fold_left (fun acc c ->
+    go "" "" acc (List.filter (fun t -> not (is_blank t)) (tokenize c.cexpr))
+  ) (Some []) conds
+
+(* Arithmetic type of a monitored value, wider last: the monitor variants of temporal_monitor.h *)
+type num_kind = KInt | KLong | KFloat | KDouble
+
+let monotonic_variant = function
+  | KInt -> ("IntMonotonicMonitor", "int_")
+  | KLong -> ("LongMonotonicMonitor", "long_")
+  | KFloat -> ("MonotonicMonitor", "")
+  | KDouble -> ("DoubleMonotonicMonitor", "double_")
+
+let kind_of_type (t : typ) : num_kind option =
+  match unrollType t with
+  | TFloat (FFloat, _) -> Some KFloat
+  | TFloat _ -> Some KDouble
+  | TInt (ik, _) ->
+      let size = bytesSizeOfInt ik and int_size = bytesSizeOfInt IInt in
+      Some (if size < int_size || (size = int_size && isSigned ik) then KInt else KLong)
+  | TEnum _ -> Some KInt
+  | _ -> None
+
+(* Type reached from t through the ".f", "->f" and "[...]" that follow a variable *)
+let rec access_type (t : typ) (toks : token list) : typ option =
+  let field t f =
+    match unrollType t with
+    | TComp (ci, _) -> (try Some (getCompField ci f).ftype with Not_found -> None)
+    | _ -> None
+  in
+  match toks with
+  | Text "." :: Ident f :: rest ->
+      (match field t f with Some t' -> access_type t' rest | None -> None)
+  | Text "-" :: Text ">" :: Ident f :: rest ->
+      (match unrollType t with
+       | TPtr (t', _) -> (match field t' f with Some t'' -> access_type t'' rest | None -> None)
+       | _ -> None)
+  | Text "[" :: rest ->
+      let rec skip depth = function
+        | Text "[" :: r -> skip (depth + 1) r
+        | Text "]" :: r -> if depth = 0 then Some r else skip (depth - 1) r
+        | _ :: r -> skip depth r
+        | [] -> None
+      in
+      (match unrollType t, skip 0 rest with
+       | (TArray (t', _, _) | TPtr (t', _)), Some rest' -> access_type t' rest'
+       | _ -> None)
+  | _ -> Some t
+
+(* Type of an expression by the usual arithmetic conversions over the variables, casts and constants it reads;
+   an int when nothing tells *)
+let expr_kind (var_type : string -> typ option) (e : string) : num_kind =
+  let literal t =
+    let l = String.length t in
+    let hex = l > 1 && t.[0] = '0' && (t.[1] = 'x' || t.[1] = 'X') in
+    if String.contains t '.' || (not hex && (String.contains t 'e' || String.contains t 'E')) then
+      Some (if t.[l - 1] = 'f' || t.[l - 1] = 'F' then KFloat else KDouble)
+    else if not hex && (t.[l - 1] = 'f' || t.[l - 1] = 'F') then Some KFloat
+    else None
+  in
+  let rec go prev acc = function
+    | [] -> acc
+    | Ident "float" :: rest -> go "float" (max acc KFloat) rest
+    | Ident "double" :: rest -> go "double" (max acc KDouble) rest
+    | Ident id :: rest when prev <> "." && prev <> ">" ->
+        let k =
+          match var_type id with
+          | Some t -> (match access_type t rest with Some t' -> kind_of_type t' | None -> None)
+          | None -> None
+        in
+        go id (match k with Some k -> max acc k | None -> acc) rest
+    | Ident id :: rest -> go id acc rest
+    | Text t :: rest when t <> "" && t.[0] >= '0' && t.[0] <= '9' ->
+        go t (match literal t with Some k -> max acc k | None -> acc) rest
+    | Text t :: rest -> go t acc rest
+  in
+  go "" KInt (List.filter (fun t -> not (is_blank t)) (tokenize e))
+
+let typed_monitor (var_type : string -> typ option) (m : monitor) : monitor =
+  if m.mtype <> "MonotonicMonitor" then m
+  else begin
+    let (mtype, prefix) = monotonic_variant (expr_kind var_type m.marg) in
+    { m with mtype = mtype; mstep = prefix ^ m.mstep }
+  end
+
+(* -------------------------------------------------- *)
+(* Main                                              *)
+(* -------------------------------------------------- *)
+
+let () =
+  (* "-diff n": differential monitor over the last n outputs (diff_monitor.h), 0 is off.
+     "-diff-threshold k": the divergence property fails once k of those n steps diverged (default 0: all n of them).
+     "-criteria": print the Frama-C slicing criteria of the conditions instead (no output file). *)
+  let usage () =
+    Printf.eprintf
+      "Usage: %s [-diff <steps>] [-diff-threshold <steps>] <harness.c> <harness.i> <entry_function> <safety_cond.txt> <output.c>\n       %s -criteria <source.c> <source.i> <entry_function> <safety_cond.txt>\n"
+      Sys.argv.(0) Sys.argv.(0);
+    exit 1
+  in
+  let rec options diff threshold criteria = function
+    | "-diff" :: n :: rest ->
+        let n = try int_of_string n with Failure _ -> -1 in
+        if n < 0 then begin
+          Printf.eprintf "%s: -diff expects a number of steps\n" Sys.argv.(0);
+          exit 1
+        end;
+        options n threshold criteria rest
+    | "-diff-threshold" :: k :: rest ->
+        let k = try int_of_string k with Failure _ -> -1 in
+        if k < 0 then begin
+          Printf.eprintf "%s: -diff-threshold expects a number of steps\n" Sys.argv.(0);
+          exit 1
+        end;
+        options diff k criteria rest
+    | "-criteria" :: rest -> options diff threshold true rest
+    | rest -> (diff, threshold, criteria, Array.of_list rest)
+  in
+  let (diff_window, diff_threshold, criteria_only, argv) =
+    options 0 0 false (List.tl (Array.to_list Sys.argv))
+  in
+  let diff_threshold = if diff_threshold = 0 then diff_window else diff_threshold in
+  if diff_window > 0 && diff_threshold > diff_window then begin
+    Printf.eprintf "%s: -diff-threshold %d can't be reached in a window of %d steps\n"
+      Sys.argv.(0) diff_threshold diff_window;
+    exit 1
+  end;
+  if Array.length argv <> (if criteria_only then 4 else 5) then usage ();
+
+  let harness_c = argv.(0) in
+  let harness_i = argv.(1) in
+  let entry = argv.(2) in
+  let cond_file = argv.(3) in
+  let output_file = if criteria_only then "" else argv.(4) in
+
+  let conds = parse_conditions cond_file in
+  if conds = [] then begin
+    Printf.eprintf "%s: no safety condition found\n" cond_file;
+    exit 1
+  end;
+
+  let src_lines = Array.of_list (read_lines harness_c) in
+  (* The monitor keeps its flags in a history buffer: a longer window can't be held *)
+  let capacity =
+    match macro_int (Array.to_list src_lines) "HISTORY_CAPACITY" with Some c -> c | None -> 8 in
+  if diff_window > capacity then begin
+    Printf.eprintf "%s: -diff %d is longer than the history capacity (HISTORY_CAPACITY %d)\n"
+      Sys.argv.(0) diff_window capacity;
+    exit 1
+  end;
+  let file = Frontc.parse harness_i () in
+  let main_fd =
+    let found = ref None in
+    iterGlobals file (function
+      | GFun (fd, _) when fd.svar.vname = "main" -> found := Some fd
+      | _ -> ());
+    match !found with
+    | Some fd -> fd
+    | None -> Printf.eprintf "main not found in %s\n" harness_c; exit 1
+  in
+  let site =
+    match find_site entry false main_fd.sbody.bstmts with
+    | Some s -> s
+    | None -> Printf.eprintf "No call to %s in main\n" entry; exit 1
+  in
+
+  (* Every identifier of a condition must be a variable of main, a global, or a macro *)
+  let in_scope =
+    List.fold_left (fun acc vi -> StringSet.add vi.vname acc)
+      (StringSet.union (global_symbols file)
+         (StringSet.union (defined_macros (Array.to_list src_lines)) c_words))
+      (main_fd.sformals @ main_fd.slocals)
+  in
+  let in_scope =
+    List.fold_left (fun acc (k, _) -> StringSet.add k acc) in_scope monitor_kinds
+  in
+  let referenced = ref StringSet.empty in
+  List.iter (fun c ->
+    List.iter (fun id ->
+      if not (StringSet.mem id in_scope) then begin
+        Printf.eprintf "%s:%d: '%s' is not a symbol of main in %s\n" cond_file c.cline id harness_c;
+        exit 1
+      end;
+      referenced := StringSet.add id !referenced
+    ) (free_idents (tokenize c.cexpr))
+  ) conds;
+
+  (* Outputs of the entry call: its left-hand side and the variables passed by address *)
+  let primes = Hashtbl.create 8 in
+  let prime (vi : varinfo) : varinfo =
+    try Hashtbl.find primes vi.vname
+    with Not_found ->
+      let vi' = copyVarinfo vi (vi.vname ^ "_prime") in
+      Hashtbl.add primes vi.vname vi';
+      vi'
+  in
+  let by_address =
+    List.fold_left (fun acc a ->
+      match a with
+      | AddrOf (Var vi, _) -> ignore (prime vi); vi :: acc
+      | _ -> acc
+    ) [] site.args
+  in
+  let lhs' =
+    match site.lhs with
+    | Some (Var vi, off) -> Some (Var (prime vi), off)
+    | Some lv -> Some lv
+    | None -> None
+  in
+  let outputs = Hashtbl.fold (fun n _ acc -> StringSet.add n acc) primes StringSet.empty in
+
+  (* -criteria: what the conditions read from the entry function, as Frama-C slicing criteria of the
+     entry function: "return" for its result, the objects behind its pointer parameters (only the
+     fields read when possible), and the globals. Inputs passed by value can't be changed by it. *)
+  if criteria_only then begin
+    let entry_formals =
+      let found = ref [] in
+      iterGlobals file (function GFun (fd, _) when fd.svar.vname = entry -> found := fd.sformals | _ -> ());
+      !found
+    in
+    let criteria = ref [] in
+    let add c = if not (List.mem c !criteria) then criteria := !criteria @ [c] in
+    let used vi = StringSet.mem vi.vname !referenced in
+    (match site.lhs with
+     | Some (Var vi, _) when used vi -> add "return"
+     | _ -> ());
+    List.iteri (fun k a ->
+      match a, (try Some (List.nth entry_formals k) with Failure _ | Invalid_argument _ -> None) with
+      | AddrOf (Var vi, NoOffset), Some formal when used vi ->
+          (match fields_of vi.vname conds with
+           | Some (_ :: _ as fields) -> List.iter (fun f -> add (formal.vname ^ "->" ^ f)) fields
+           | _ -> add ("*" ^ formal.vname))
+      | AddrOf (Var vi, _), Some formal when used vi -> add ("*" ^ formal.vname)
+      | StartOf (Var vi, _), _ when used vi ->
+          E.warn "%s is passed as an array, not used as a slicing criterion" vi.vname
+      | _ -> ()
+    ) site.args;
+    StringSet.iter (fun id ->
+      List.iter (function
+        | GVar (vi, _, _) | GVarDecl (vi, _) when vi.vname = id && not (isFunctionType vi.vtype) ->
+            (match fields_of id conds with
+             | Some (_ :: _ as fields) -> List.iter (fun f -> add (id ^ "." ^ f)) fields
+             | _ -> add id)
+        | _ -> ()
+      ) file.globals
+    ) !referenced;
+    List.iter print_endline !criteria;
+    exit 0
+  end;
+
+  (* Conditions with their monitor applications replaced by the monitor outputs *)
+  let compiled =
+    List.map (fun c ->
+      let where = Printf.sprintf "%s:%d" cond_file c.cline in
+      (c, tokens_to_string (extract_monitors where (tokenize c.cexpr)))
+    ) conds
+  in
+  let var_type id =
+    match List.filter (fun vi -> vi.vname = id) (main_fd.sformals @ main_fd.slocals) with
+    | vi :: _ -> Some vi.vtype
+    | [] ->
+        List.fold_left (fun acc g ->
+          match g with
+          | GVar (vi, _, _) | GVarDecl (vi, _) when vi.vname = id && not (isFunctionType vi.vtype) -> Some vi.vtype
+          | _ -> acc
+        ) None file.globals
+  in
+  monitors := List.map (typed_monitor var_type) !monitors;
+  (* The primed side reads the primed outputs, its own copy of every monitor and of every source global *)
+  let globals = source_globals file harness_c in
+  let global_names = List.fold_left (fun acc (vi, _) -> StringSet.add vi.vname acc) StringSet.empty globals in
+  let primed_names =
+    List.fold_left (fun acc m -> StringSet.add m.mname acc) (StringSet.union outputs global_names) !monitors
+  in
+  let prime_expr (e : string) : string =
+    map_idents (fun member id ->
+      if not member && StringSet.mem id primed_names then id ^ "_prime" else id) (tokenize e)
+  in
+
+  let str d = Pretty.sprint ~width:1000 d in
+  let indent =
+    let l = src_lines.(site.call_line - 1) in
+    let n = ref 0 in
+    while !n < String.length l && (l.[!n] = ' ' || l.[!n] = '\t') do incr n done;
+    String.sub l 0 !n
+  in
+
+  (* Insertions, keyed by line of the harness *)
+  let before = Hashtbl.create 8 and after = Hashtbl.create 8 in
+  let add tbl line text =
+    Hashtbl.replace tbl line ((try Hashtbl.find tbl line with Not_found -> []) @ [text])
+  in
+
+  (* Primed copies of the source globals, defined right before main with the same initializers *)
+  let main_line =
+    let l = main_fd.svar.vdecl.line in
+    let text = String.trim src_lines.(l - 1) in
+    if l > 1 && String.length text >= 4 && String.sub text 0 4 = "main" then l - 1 else l
+  in
+  List.iter (fun (vi, init) ->
+    let vi' = copyVarinfo vi (vi.vname ^ "_prime") in
+    vi'.vstorage <- NoStorage;
+    add before main_line
+      (str (defaultCilPrinter#pVDecl () vi')
+       ^ (match init.init with Some i -> " = " ^ str (d_init () i) | None -> "") ^ ";")
+  ) globals;
+  (* What main writes to them, itself or through a function other than the entry function (the inputs it sets),
+     is copied to the primed side, so both calls start from the same inputs *)
+  let writes = global_writes file global_names in
+  let line_indent line =
+    let l = src_lines.(line - 1) in
+    let n = ref 0 in
+    while !n < String.length l && (l.[!n] = ' ' || l.[!n] = '\t') do incr n done;
+    String.sub l 0 !n
+  in
+  let copy_global name =
+    let vi = fst (List.find (fun (vi, _) -> vi.vname = name) globals) in
+    if isArrayType vi.vtype then Printf.sprintf "__builtin_memcpy(%s_prime, %s, sizeof(%s));" name name name
+    else Printf.sprintf "%s_prime = %s;" name name
+  in
+  ignore (visitCilFunction (object
+    inherit nopCilVisitor
+    method vinst i =
+      if not (is_entry_call entry i) then begin
+        let written = ref StringSet.empty and callees = ref [] in
+        ignore (visitCilInstr (new globalWritesVisitor global_names written callees) i);
+        let all =
+          List.fold_left (fun acc c -> try StringSet.union acc (Hashtbl.find writes c) with Not_found -> acc)
+            !written !callees
+        in
+        let line = (get_instrLoc i).line in
+        if line > 0 && line <= Array.length src_lines then
+          StringSet.iter (fun g -> add after line (line_indent line ^ copy_global g)) all
+      end;
+      SkipChildren
+  end) main_fd);
+
+  (* Declarations of the primed outputs, right after the opening brace of main *)
+  let main_open =
+    let l = ref (main_fd.svar.vdecl.line - 1) in
+    while !l < Array.length src_lines && not (String.contains src_lines.(!l) '{') do incr l done;
+    !l + 1
+  in
+  Hashtbl.iter (fun _ vi' ->
+    add after main_open ("    " ^ str (defaultCilPrinter#pVDecl () vi') ^ ";")
+  ) primes;
+  List.iter (fun m ->
+    List.iter (fun name ->
+      add after main_open (Printf.sprintf "    %s %s_state = {0};" m.mtype name);
+      add after main_open (Printf.sprintf "    int %s = 0;" name)
+    ) [m.mname; m.mname ^ "_prime"]
+  ) !monitors;
+
+  (* The primed call gets the same inputs; outputs passed by address start from the same value *)
+  List.iter (fun vi ->
+    add before site.call_line (indent ^ (prime vi).vname ^ " = " ^ vi.vname ^ ";")
+  ) by_address;
+  let args' =
+    List.map (function
+      | AddrOf (Var vi, off) when StringSet.mem vi.vname outputs -> AddrOf (Var (prime vi), off)
+      | a -> a
+    ) site.args
+  in
+  let call' =
+    entry ^ "_prime(" ^ String.concat ", " (List.map (fun a -> str (d_exp () a)) args') ^ ");"
+  in
+  add after site.call_line
+    (indent ^ (match lhs' with Some lv -> str (d_lval () lv) ^ " = " | None -> "") ^ call');
+
+  (* Differential monitor: both outputs are compared in their own type after every call, and the property fails
+     once they have differed on diff_threshold of the last n steps *)
+  let diff_used = ref false in
+  if diff_window > 0 then begin
+    match site.lhs, lhs' with
+    | Some lv, Some lv' ->
+        add after main_open (Printf.sprintf "    DiffMonitor seu_diff = DIFF_MONITOR_INIT(%d);" diff_window);
+        add after main_open "    unsigned seu_diff_count = 0;";
+        diff_used := true;
+        add after site.call_line
+          (Printf.sprintf "%sseu_diff_count = diff_step(&seu_diff, (%s) != (%s));"
+             indent (str (d_lval () lv)) (str (d_lval () lv')));
+        add after site.call_line
+          (Printf.sprintf "%sSEU_PROPERTY(output_divergence, seu_diff_count < %du);" indent diff_threshold)
+    | _ ->
+        E.warn "%s returns nothing, no differential monitor" entry
+  end;
+
+  (* Earliest point where every referenced value is final: after the last write to one of them
+     that follows the call in the same block. *)
+  let prop_line, prop_after =
+    match last_matching (instr_writes !referenced) site.after_call with
+    | Some (_, i) -> (get_instrLoc i).line, true
+    | None ->
+        (match last_matching (stmt_writes !referenced) site.later with
+         | Some (idx, _) when idx + 1 < List.length site.later ->
+             (get_stmtLoc (List.nth site.later (idx + 1)).skind).line, false
+         | Some _ ->
+             E.warn "a referenced variable is written at the end of the block, asserting right after the call";
+             site.call_line, true
+         | None -> site.call_line, true)
+  in
+  let steps =
+    List.concat (List.map (fun m ->
+      [ Printf.sprintf "%s%s = %s(&%s_state, (%s), %s);"
+          indent m.mname m.mstep m.mname m.marg m.mdepth;
+        Printf.sprintf "%s%s_prime = %s(&%s_prime_state, (%s), %s);"
+          indent m.mname m.mstep m.mname (prime_expr m.marg) m.mdepth ]
+    ) !monitors)
+  in
+  let props =
+    List.map (fun (c, e) ->
+      indent ^ "SEU_PROPERTY(" ^ c.cname ^ ", !(" ^ e ^ ") || (" ^ prime_expr e ^ "));"
+    ) compiled
+  in
+  let props = steps @ props in
+  (* Nothing after the properties can matter, unless a loop comes back to them *)
+  let props =
+    if site.in_loop then props
+    else props @ [indent ^ "__CPROVER_assume(0); /* all properties checked, cut the rest */"]
+  in
+  List.iter (add (if prop_after then after else before) prop_line) props;
+
+  (* Longest window the properties read (monitor depths, differential window), for the induction depth of
+     verify_crv.sh: printed as "WINDOW: n" *)
+  let depth_of m =
+    match (try Some (int_of_string m.mdepth) with Failure _ -> macro_int (Array.to_list src_lines) m.mdepth) with
+    | Some d -> d
+    | None -> E.warn "the depth '%s' of a monitor is not a constant, left out of the window" m.mdepth; 0
+  in
+  let window =
+    List.fold_left (fun acc m -> max acc (depth_of m)) (if !diff_used then diff_window else 0) !monitors
+  in
+
+  let oc = open_out output_file in
+  Array.iteri (fun idx l ->
+    let line = idx + 1 in
+    List.iter (fun t -> output_string oc (t ^ "\n")) (try Hashtbl.find before line with Not_found -> []);
+    output_string oc (l ^ "\n");
+    List.iter (fun t -> output_string oc (t ^ "\n")) (try Hashtbl.find after line with Not_found -> [])
+  ) src_lines;
+  close_out oc;
+
+  Printf.printf "Inserted %d safety properties after line %d of %s, written to %s\n"
+    (List.length conds) prop_line harness_c output_file;
+  Printf.printf "WINDOW: %d\n" window
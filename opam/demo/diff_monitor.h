@@ -0,0 +1,37 @@
+#ifndef DIFF_MONITOR_H
+#define DIFF_MONITOR_H
+
+#include <stdbool.h>
+#include "history_buffer.h"
+
+// Differential monitor of the entry function's output: every step records whether the original and the primed
+// output differed (compared by the caller in the output's own type, so a float divergence isn't cut off by an int
+// conversion), and keeps the number of diverging steps among the last 'window'. The flag leaving the window is
+// popped from the monitor's own history and taken off the count, so a step costs the same for any window, with no
+// loop and no trace kept, natively as well as in CBMC.
+
+typedef struct {
+    unsigned window;     // steps compared, at most HISTORY_CAPACITY (compile_safety_cond rejects longer windows)
+    unsigned diverging;  // steps among the last 'window' where output != output_prime
+    IntHistory flags;    // 1 for a diverging step, oldest first
+} DiffMonitor;
+
+#define DIFF_MONITOR_INIT(window) { ((window) > HISTORY_CAPACITY ? HISTORY_CAPACITY : (window)), 0, { {0}, 0, 0 } }
+
+static inline void initDiffMonitor(DiffMonitor *m, unsigned window) {
+    m->window = (window == 0 || window > HISTORY_CAPACITY) ? HISTORY_CAPACITY : window;
+    m->diverging = 0;
+    initIntHistory(&m->flags);
+}
+
+// Returns the number of diverging steps in the window, this one included.
+static inline unsigned diff_step(DiffMonitor *m, bool diverged) {
+    if (m->flags.count >= m->window) {
+        m->diverging -= (unsigned)popIntHistory(&m->flags);
+    }
+    pushIntHistory(&m->flags, diverged ? 1 : 0);
+    m->diverging += diverged ? 1u : 0u;
+    return m->diverging;
+}
+
+#endif // DIFF_MONITOR_H
@@ -0,0 +1,115 @@
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+// Fixed-point model of the floating-point arithmetic of a product program, for the screening pass of
+// float_to_fixed.ml: every float and double becomes a fixed_t holding round(x * 2^FIXED_FRAC_BITS), so cbmc
+// works on plain bitvectors instead of bit-blasting IEEE operations.
+// The arithmetic is checked against the fixed range; products and quotients are truncated to a raw unit, and
+// the rounding errors of the float program aren't modelled either, so the errors of neither side are bounded:
+// the fixed program only approximates the float one, and its verdicts are hints (a CRV is confirmed in float).
+// A comparison that FIXED_EPS (raw units) can't decide is left to the solver. A value leaving the fixed range,
+// or a division by a value that may be 0, fails the "fixed_range" property. NaN and infinities have no fixed
+// counterpart, which is why float targets aren't screened.
+
+#ifndef FIXED_FRAC_BITS
+#define FIXED_FRAC_BITS 16
+#endif
+#ifndef FIXED_EPS
+#define FIXED_EPS 64        // 2^-10 with 16 fractional bits
+#endif
+
+typedef long long fixed_t;
+
+#define FIXED_ONE (1LL << FIXED_FRAC_BITS)
+#define FIXED_MAX (1LL << 62)
+
+int nondet_int();
+long long nondet_long_long();
+
+static inline fixed_t fx_checked(__int128 v) {
+    __CPROVER_assert(v >= -FIXED_MAX && v <= FIXED_MAX, "fixed_range");
+    return (fixed_t)v;
+}
+
+static inline fixed_t fx_add(fixed_t a, fixed_t b) {
+    return fx_checked((__int128)a + b);
+}
+
+static inline fixed_t fx_sub(fixed_t a, fixed_t b) {
+    return fx_checked((__int128)a - b);
+}
+
+static inline fixed_t fx_mul(fixed_t a, fixed_t b) {
+    return fx_checked(((__int128)a * b) >> FIXED_FRAC_BITS);
+}
+
+static inline fixed_t fx_div(fixed_t a, fixed_t b) {
+    __CPROVER_assert(b > FIXED_EPS || b < -FIXED_EPS, "fixed_range");
+    return fx_checked(((__int128)a * FIXED_ONE) / (b != 0 ? b : 1));
+}
+
+static inline fixed_t fx_of_int(long long i) {
+    return fx_checked((__int128)i * FIXED_ONE);
+}
+
+// a < b, a <= b, a == b: decided when a - b is more than FIXED_EPS away from the boundary, nondet otherwise.
+static inline int fx_lt(fixed_t a, fixed_t b) {
+    if (a - b < -FIXED_EPS) return 1;
+    if (a - b >= FIXED_EPS) return 0;
+    return nondet_int() != 0;
+}
+
+static inline int fx_le(fixed_t a, fixed_t b) {
+    if (a - b <= -FIXED_EPS) return 1;
+    if (a - b > FIXED_EPS) return 0;
+    return nondet_int() != 0;
+}
+
+static inline int fx_eq(fixed_t a, fixed_t b) {
+    if (a - b > FIXED_EPS || a - b < -FIXED_EPS) return 0;
+    if (FIXED_EPS == 0) return 1;
+    return nondet_int() != 0;
+}
+
+// (int)x truncates toward 0, any of the integers within FIXED_EPS of the value.
+static inline int fx_to_int(fixed_t a) {
+    int lo = (int)((a - FIXED_EPS) / FIXED_ONE);
+    int hi = (int)((a + FIXED_EPS) / FIXED_ONE);
+    int r = nondet_int();
+    __CPROVER_assume(r >= lo && r <= hi);
+    return r;
+}
+
+// math.h: fabs, fmin and fmax are exact; floor and ceil pick among the integers within FIXED_EPS.
+static inline fixed_t fx_abs(fixed_t a) {
+    return a < 0 ? -a : a;
+}
+
+static inline fixed_t fx_min(fixed_t a, fixed_t b) {
+    return a < b ? a : b;
+}
+
+static inline fixed_t fx_max(fixed_t a, fixed_t b) {
+    return a > b ? a : b;
+}
+
+static inline fixed_t fx_floor(fixed_t a) {
+    fixed_t lo = (a - FIXED_EPS) >> FIXED_FRAC_BITS;
+    fixed_t hi = (a + FIXED_EPS) >> FIXED_FRAC_BITS;
+    fixed_t r = nondet_long_long();
+    __CPROVER_assume(r >= lo && r <= hi);
+    return r * FIXED_ONE;
+}
+
+static inline fixed_t fx_ceil(fixed_t a) {
+    return -fx_floor(-a);
+}
+
+// Any other floating-point library call: any value of the fixed range.
+static inline fixed_t fx_nondet(void) {
+    fixed_t r = nondet_long_long();
+    __CPROVER_assume(r >= -FIXED_MAX && r <= FIXED_MAX);
+    return r;
+}
+
+#endif // FIXED_POINT_H
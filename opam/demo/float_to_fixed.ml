@@ -0,0 +1,264 @@
+open Cil
+module E = Errormsg
+
+(* Fixed-point screening of a CBMC ready product program (preprocessed): every float and double of the file
+   becomes a fixed_t of fixed_point.h (round(x * 2^frac) in a long long) and the floating-point operations
+   become integer ones:
+     - constants are scaled, unary - stays as it is;
+     - + - * / go through fx_add/fx_sub/fx_mul/fx_div, which check the fixed range;
+     - the comparisons go through fx_lt/fx_le/fx_eq, which are nondet within the declared error bound (-eps,
+       raw units);
+     - int -> float is fx_of_int, float -> int fx_to_int; fabs/fmin/fmax/floor/ceil get their fixed models and
+       any other floating-point library call returns any fixed value (the libm_models.h bodies are dropped).
+   The calls are hoisted into temporaries in front of the instruction or statement the expression belongs to;
+   those of a branch of "c ? a : b" only run on that branch. The rounding errors aren't bounded, so the fixed
+   program approximates the float one: its verdict is a hint, and a CRV is confirmed in float.
+   A flip of a floating-point object can make it a NaN or an infinity, which have no fixed counterpart: those
+   programs aren't translated (exit status 2). *)
+
+let frac = ref 16
+let eps = ref 64L
+
+let fixed_type = TInt (ILongLong, [])
+
+let is_float_type (t : typ) : bool =
+  match unrollType t with
+  | TFloat _ -> true
+  | _ -> false
+
+let to_fixed (f : float) : exp =
+  kinteger64 ILongLong (Int64.of_float (floor (f *. (2.0 ** float_of_int !frac) +. 0.5)))
+
+(* Parameters of a fixed_point.h prototype *)
+let fx_params (args : exp list) : (string * typ * attributes) list =
+  List.mapi (fun i _ -> (Printf.sprintf "x%d" i, fixed_type, [])) args
+
+let rec strip_casts = function
+  | CastE (_, e) -> strip_casts e
+  | e -> e
+
+(* Float value of a constant expression (global initializers, where no call can go) *)
+let rec eval_float (e : exp) : float option =
+  match e with
+  | Const (CReal (f, _, _)) -> Some f
+  | Const (CInt64 (i, _, _)) -> Some (Int64.to_float i)
+  | CastE (_, e1) -> eval_float e1
+  | UnOp (Neg, e1, _) -> (match eval_float e1 with Some v -> Some (-. v) | None -> None)
+  | BinOp ((PlusA | MinusA | Mult | Div) as op, e1, e2, _) ->
+      (match eval_float e1, eval_float e2 with
+       | Some a, Some b ->
+           Some (match op with PlusA -> a +. b | MinusA -> a -. b | Mult -> a *. b | _ -> a /. b)
+       | _ -> None)
+  | _ -> None
+
+exception Float_target of string
+
+(* -------------------------------------------------- *)
+(* Expressions                                        *)
+(* -------------------------------------------------- *)
+(* Rewrites an expression of the float program, the statements computing the calls it needs are added to pre
+   (in reverse order) *)
+let rec rewrite_exp (file : file) (fd : fundec) (pre : stmt list ref) (loc : location) : exp -> exp =
+  let call name rt args =
+    let f = findOrCreateFunc file name
+      (TFun (rt, Some (fx_params args), false, [])) in
+    let tmp = makeTempVar fd ~name:"fx" rt in
+    pre := mkStmtOneInstr (Call (Some (Var tmp, NoOffset), Lval (Var f, NoOffset), args, loc)) :: !pre;
+    Lval (Var tmp, NoOffset)
+  in
+  let rec rw (e : exp) : exp =
+    match e with
+    | Const (CReal (f, _, _)) -> to_fixed f
+    | BinOp (PlusA, a, b, t) when is_float_type t -> call "fx_add" fixed_type [rw a; rw b]
+    | BinOp (MinusA, a, b, t) when is_float_type t -> call "fx_sub" fixed_type [rw a; rw b]
+    | BinOp (Mult, a, b, t) when is_float_type t -> call "fx_mul" fixed_type [rw a; rw b]
+    | BinOp (Div, a, b, t) when is_float_type t -> call "fx_div" fixed_type [rw a; rw b]
+    | BinOp ((Lt | Gt | Le | Ge | Eq | Ne) as op, a, b, t) when is_float_type (typeOf a) ->
+        let (a, b) = (rw a, rw b) in
+        (match op with
+         | Lt -> call "fx_lt" intType [a; b]
+         | Gt -> call "fx_lt" intType [b; a]
+         | Le -> call "fx_le" intType [a; b]
+         | Ge -> call "fx_le" intType [b; a]
+         | Eq -> call "fx_eq" intType [a; b]
+         | _ -> UnOp (LNot, call "fx_eq" intType [a; b], t))
+    | BinOp (op, a, b, t) -> BinOp (op, rw a, rw b, t)
+    | UnOp (LNot, a, _) when is_float_type (typeOf a) -> call "fx_eq" intType [rw a; kinteger64 ILongLong 0L]
+    | UnOp (op, a, t) -> UnOp (op, rw a, t)
+    | CastE (t, a) when is_float_type t ->
+        if is_float_type (typeOf a) then rw a
+        else (match isInteger (constFold true a) with
+              | Some c -> to_fixed (Int64.to_float c)
+              | None -> call "fx_of_int" fixed_type [CastE (fixed_type, rw a)])
+    | CastE (t, a) when is_float_type (typeOf a) -> CastE (t, call "fx_to_int" intType [rw a])
+    | CastE (t, a) -> CastE (t, rw a)
+    | Question (c, a, b, t) ->
+        (* The calls of a branch go under the condition, so an fx_div of the branch not taken can't fail *)
+        let c' = rw c in
+        let branch e =
+          let p = ref [] in
+          let e' = rewrite_exp file fd p loc e in
+          (List.rev !p, e')
+        in
+        let (pa, a') = branch a and (pb, b') = branch b in
+        if pa = [] && pb = [] then Question (c', a', b', t)
+        else begin
+          let tmp = makeTempVar fd ~name:"fx" t in
+          let set e = mkStmtOneInstr (Set ((Var tmp, NoOffset), e, loc)) in
+          pre := mkStmt (If (c', mkBlock (pa @ [set a']), mkBlock (pb @ [set b']), loc)) :: !pre;
+          Lval (Var tmp, NoOffset)
+        end
+    | Lval lv -> Lval (rw_lval lv)
+    | AddrOf lv -> AddrOf (rw_lval lv)
+    | StartOf lv -> StartOf (rw_lval lv)
+    | _ -> e
+  and rw_lval ((host, off) : lval) : lval =
+    ((match host with Mem e -> Mem (rw e) | h -> h), rw_offset off)
+  and rw_offset (off : offset) : offset =
+    match off with
+    | Index (e, o) -> Index (rw e, rw_offset o)
+    | Field (f, o) -> Field (f, rw_offset o)
+    | NoOffset -> NoOffset
+  in
+  rw
+
+(* The models of libm_models.h stand for the library functions *)
+let is_libm_model (name : string) : bool = String.length name > 4 && String.sub name 0 4 = "seu_"
+
+(* Fixed model of a floating-point library function (declared, not defined in the file, or a libm_models.h one) *)
+let libm_model (name : string) : string =
+  let name = if is_libm_model name then String.sub name 4 (String.length name - 4) else name in
+  match name with
+  | "fabs" | "fabsf" | "fabsl" -> "fx_abs"
+  | "fmin" | "fminf" -> "fx_min"
+  | "fmax" | "fmaxf" -> "fx_max"
+  | "floor" | "floorf" -> "fx_floor"
+  | "ceil" | "ceilf" -> "fx_ceil"
+  | _ -> "fx_nondet"
+
+let rewrite_instr (file : file) (defined : (string, unit) Hashtbl.t) (fd : fundec) (i : instr) : stmt list =
+  let pre = ref [] in
+  let loc = get_instrLoc i in
+  let rw = rewrite_exp file fd pre loc in
+  let i' =
+    match i with
+    | Set (lv, e, loc) ->
+        (match rw (Lval lv) with
+         | Lval lv' -> Set (lv', rw e, loc)
+         | _ -> i)
+    | Call (_, Lval (Var f, NoOffset), a :: _, _)
+      when String.length f.vname >= 17 && String.sub f.vname 0 17 = "simulate_seu_main"
+           && (match strip_casts a with AddrOf lv -> is_float_type (typeOfLval lv) | _ -> false) ->
+        raise (Float_target (Pretty.sprint ~width:80 (d_exp () a)))
+    | Call (ret, fn, args, loc) ->
+        let ret' = match ret with
+          | Some lv -> (match rw (Lval lv) with Lval lv' -> Some lv' | _ -> ret)
+          | None -> None in
+        let args' = List.map rw args in
+        (match fn with
+         | Lval (Var f, NoOffset) when (not (Hashtbl.mem defined f.vname) || is_libm_model f.vname)
+                                    && (match unrollType f.vtype with TFun (rt, _, _, _) -> is_float_type rt | _ -> false) ->
+             let model = libm_model f.vname in
+             let args' = if model = "fx_nondet" then [] else args' in
+             let mf = findOrCreateFunc file model
+               (TFun (fixed_type, Some (fx_params args'), false, [])) in
+             Call (ret', Lval (Var mf, NoOffset), args', loc)
+         | _ -> Call (ret', rw fn, args', loc))
+    | _ -> i
+  in
+  List.rev !pre @ [mkStmtOneInstr i']
+
+(* -------------------------------------------------- *)
+(* Statements and types                               *)
+(* -------------------------------------------------- *)
+class fixedVisitor (file : file) (defined : (string, unit) Hashtbl.t) (fd : fundec) = object
+  inherit nopCilVisitor
+
+  (* After the children: the statement's own expressions, with the calls they need in front of it *)
+  method vstmt (s : stmt) =
+    let with_pre loc (e : exp) (k : exp -> stmtkind) =
+      let pre = ref [] in
+      let e' = rewrite_exp file fd pre loc e in
+      if !pre = [] then s.skind <- k e'
+      else s.skind <- Block (mkBlock (List.rev !pre @ [mkStmt (k e')]))
+    in
+    let post (s : stmt) =
+      (match s.skind with
+       | Instr il ->
+           (match compactStmts (List.concat (List.map (rewrite_instr file defined fd) il)) with
+            | [{ skind = Instr il' }] -> s.skind <- Instr il'
+            | stmts -> s.skind <- Block (mkBlock stmts))
+       | If (e, b1, b2, loc) -> with_pre loc e (fun e' -> If (e', b1, b2, loc))
+       | Return (Some e, loc) -> with_pre loc e (fun e' -> Return (Some e', loc))
+       | Switch (e, b, cases, loc) -> with_pre loc e (fun e' -> Switch (e', b, cases, loc))
+       | _ -> ());
+      s
+    in
+    ChangeDoChildrenPost (s, post)
+end
+
+class typeVisitor = object
+  inherit nopCilVisitor
+
+  method vtype (t : typ) =
+    match t with
+    | TFloat (_, a) -> ChangeTo (TInt (ILongLong, a))
+    | _ -> DoChildren
+end
+
+(* Global initializers are constant: they are evaluated in float and scaled *)
+let rec rewrite_init (t : typ) (i : init) : init =
+  match i with
+  | SingleInit e when is_float_type t ->
+      (match eval_float e with
+       | Some v -> SingleInit (to_fixed v)
+       | None ->
+           Printf.eprintf "Unsupported floating-point initializer: %s\n" (Pretty.sprint ~width:80 (d_exp () e));
+           exit 1)
+  | SingleInit _ -> i
+  | CompoundInit (ct, inits) ->
+      CompoundInit (ct, List.map (fun (off, i) -> (off, rewrite_init (typeOffset ct off) i)) inits)
+
+let () =
+  let rec options = function
+    | "-frac" :: n :: rest -> frac := int_of_string n; options rest
+    | "-eps" :: n :: rest -> eps := Int64.of_string n; options rest
+    | [input_file; output_file] -> (input_file, output_file)
+    | _ ->
+        Printf.eprintf "Usage: %s [-frac <fractional bits>] [-eps <error bound, raw units>] <cbmc_ready.i> <output_file>\n"
+          Sys.argv.(0);
+        exit 1
+  in
+  let (input_file, output_file) = options (List.tl (Array.to_list Sys.argv)) in
+  let f = Frontc.parse input_file () in
+
+  let defined = Hashtbl.create 17 in
+  iterGlobals f (function GFun (fd, _) -> Hashtbl.replace defined fd.svar.vname () | _ -> ());
+  (* The libm_models.h models are replaced by the fixed ones at every call: their float bodies are dropped *)
+  let float_model vi =
+    is_libm_model vi.vname
+    && (match unrollType vi.vtype with TFun (rt, _, _, _) -> is_float_type rt | _ -> false)
+  in
+  f.globals <- List.filter (function
+    | GFun (fd, _) -> not (float_model fd.svar)
+    | GVarDecl (vi, _) -> not (float_model vi)
+    | _ -> true) f.globals;
+  (try
+     iterGlobals f (function
+       | GFun (fd, _) -> ignore (visitCilFunction (new fixedVisitor f defined fd) fd)
+       | GVar (vi, ii, _) -> (match ii.init with Some i -> ii.init <- Some (rewrite_init vi.vtype i) | None -> ())
+       | _ -> ())
+   with Float_target target ->
+     Printf.printf "Floating-point target %s, not screened in fixed point\n" target;
+     exit 2);
+  visitCilFile (new typeVisitor) f;
+  (* cbmc knows its builtins, the implicit declarations CIL made for them would clash *)
+  f.globals <- List.filter (function
+    | GVarDecl (vi, _) -> not (String.length vi.vname > 10 && String.sub vi.vname 0 10 = "__CPROVER_")
+    | _ -> true) f.globals;
+
+  let out_channel = open_out output_file in
+  Printf.fprintf out_channel "#define FIXED_FRAC_BITS %d\n#define FIXED_EPS %LdLL\n#include \"/home/opam/demo/fixed_point.h\"\n\n"
+    !frac !eps;
+  dumpFile defaultCilPrinter out_channel output_file f;
+  close_out out_channel
@@ -0,0 +1,270 @@
+open Cil
+module E = Errormsg
+
+(* Pre-verification rewrite of a CBMC ready product program (preprocessed): the single-instance heap objects of
+   main (a malloc(sizeof(T)) or calloc(1, sizeof(T)) run once, outside any loop, ex: the ReactorState,
+   MonitoringData and SafetyController of chemical_reactor.c) become static objects, so cbmc has no dynamic
+   object to encode. The object's contents stay nondet like malloc's (__CPROVER_havoc_object where the call was,
+   calloc's zeroes come with static storage), and the free() of their pointers is dropped.
+   A struct object is also split into one global variable per field when every pointer that can hold its
+   address holds only that address (main's locals, and the formals of the functions it is passed to), and is
+   only used for p->field accesses, passed on, copied or tested against NULL. Every p->f then becomes the plain
+   variable <object>_f. *)
+
+let rec strip_casts = function
+  | CastE (_, e) -> strip_casts e
+  | e -> e
+
+let is_null (e : exp) : bool = isZero (strip_casts e)
+
+type heap_obj = {
+  id : int;
+  alloc : instr;                              (* the malloc/calloc call *)
+  origin : varinfo;                           (* where its result is stored *)
+  otype : typ;
+  zeroed : bool;                              (* calloc *)
+  mutable obj : varinfo option;
+  mutable split : bool;
+  fields : (string, varinfo) Hashtbl.t;       (* field name -> its variable, when split *)
+}
+
+(* -------------------------------------------------- *)
+(* Single-instance allocations of main                *)
+(* -------------------------------------------------- *)
+class allocVisitor (found : heap_obj list ref) = object
+  inherit nopCilVisitor
+  val mutable loops = 0
+
+  method vstmt (s : stmt) =
+    match s.skind with
+    | Loop _ -> loops <- loops + 1; ChangeDoChildrenPost (s, fun s -> loops <- loops - 1; s)
+    | _ -> DoChildren
+
+  method vinst (i : instr) =
+    (match i with
+     | Call (Some (Var v, NoOffset), Lval (Var f, NoOffset), args, _) when loops = 0 ->
+         let add t zeroed =
+           found := { id = List.length !found; alloc = i; origin = v; otype = t; zeroed = zeroed;
+                      obj = None; split = false; fields = Hashtbl.create 17 } :: !found in
+         (match f.vname, List.map strip_casts args with
+          | "malloc", [SizeOf t] -> add t false
+          | "malloc", [SizeOfE e] -> add (typeOf e) false
+          | "calloc", [n; SizeOf t] when isInteger n = Some 1L -> add t true
+          | _ -> ())
+     | _ -> ());
+    SkipChildren
+end
+
+(* -------------------------------------------------- *)
+(* Which pointers can hold which objects              *)
+(* -------------------------------------------------- *)
+let pts : (int, int list) Hashtbl.t = Hashtbl.create 17      (* vid -> objects it may point to *)
+let unknown : (int, unit) Hashtbl.t = Hashtbl.create 17      (* vid -> may also hold anything else *)
+let changed = ref false
+
+let tracked (v : varinfo) : bool = Hashtbl.mem pts v.vid
+let pts_of (v : varinfo) : int list = try Hashtbl.find pts v.vid with Not_found -> []
+
+let add_pts (v : varinfo) (ids : int list) =
+  let cur = pts_of v in
+  let fresh = List.filter (fun i -> not (List.mem i cur)) ids in
+  if fresh <> [] then begin Hashtbl.replace pts v.vid (cur @ fresh); changed := true end
+
+let mark_unknown (v : varinfo) =
+  if not (Hashtbl.mem unknown v.vid) then begin Hashtbl.replace unknown v.vid (); changed := true end
+
+(* The tracked pointer an expression copies, if any *)
+let tracked_src (e : exp) : varinfo option =
+  match strip_casts e with
+  | Lval (Var v, NoOffset) when tracked v -> Some v
+  | _ -> None
+
+(* Value flow into a variable: from a tracked pointer, or from anything else *)
+let flow (dst : varinfo) (e : exp option) =
+  match (match e with Some e -> tracked_src e | None -> None) with
+  | Some src ->
+      add_pts dst (pts_of src);
+      if Hashtbl.mem unknown src.vid then mark_unknown dst
+  | None -> if tracked dst then mark_unknown dst
+
+class flowVisitor (allocs : heap_obj list) (fundecs : (string, fundec) Hashtbl.t) = object
+  inherit nopCilVisitor
+
+  method vinst (i : instr) =
+    (if List.exists (fun a -> a.alloc == i) allocs then ()
+     else match i with
+       | Set ((Var q, NoOffset), e, _) -> flow q (Some e)
+       | Call (ret, fn, args, _) ->
+           (match ret with Some (Var q, NoOffset) -> flow q None | _ -> ());
+           (match fn with
+            | Lval (Var f, NoOffset) when Hashtbl.mem fundecs f.vname ->
+                let rec pair formals args =
+                  match formals, args with
+                  | v :: fs, a :: rest -> flow v (Some a); pair fs rest
+                  | _ -> ()
+                in
+                pair (Hashtbl.find fundecs f.vname).sformals args
+            | _ -> ())
+       | _ -> ());
+    SkipChildren
+end
+
+(* Uses of a tracked pointer other than p->f, passing it on, copying it, testing it or freeing it: its objects
+   can't be split *)
+class escapeVisitor (allocs : heap_obj list) (fundecs : (string, fundec) Hashtbl.t)
+    (no_split : (int, unit) Hashtbl.t) = object (self)
+  inherit nopCilVisitor
+
+  method private escape (v : varinfo) = List.iter (fun id -> Hashtbl.replace no_split id ()) (pts_of v)
+
+  method vinst (i : instr) =
+    match i with
+    | _ when List.exists (fun a -> a.alloc == i) allocs -> SkipChildren
+    | Set ((Var _, NoOffset), e, _) when tracked_src e <> None -> SkipChildren
+    | Call (_, Lval (Var f, NoOffset), [a], _) when f.vname = "free" && tracked_src a <> None -> SkipChildren
+    | Call (ret, Lval (Var f, NoOffset), args, _) when Hashtbl.mem fundecs f.vname ->
+        (match ret with Some lv -> ignore (visitCilLval (self :> cilVisitor) lv) | None -> ());
+        let rec pair formals args =
+          match formals, args with
+          | _ :: fs, (Lval (Var v, NoOffset)) :: rest when tracked v -> pair fs rest
+          | fs, a :: rest -> ignore (visitCilExpr (self :> cilVisitor) a); pair (match fs with _ :: t -> t | [] -> []) rest
+          | _, [] -> ()
+        in
+        pair (Hashtbl.find fundecs f.vname).sformals args;
+        SkipChildren
+    | _ -> DoChildren
+
+  method vlval (lv : lval) =
+    match lv with
+    | (Mem (Lval (Var v, NoOffset)), (Field _ as off)) when tracked v ->
+        ignore (visitCilOffset (self :> cilVisitor) off);
+        SkipChildren
+    | _ -> DoChildren
+
+  method vexpr (e : exp) =
+    match e with
+    | UnOp (LNot, a, _) when tracked_src a <> None -> SkipChildren
+    | BinOp ((Eq | Ne), a, b, _) when (tracked_src a <> None && is_null b) || (is_null a && tracked_src b <> None) ->
+        SkipChildren
+    | Lval (Var v, NoOffset) | AddrOf (Var v, _) when tracked v -> self#escape v; SkipChildren
+    | _ -> DoChildren
+end
+
+(* -------------------------------------------------- *)
+(* Rewrite                                            *)
+(* -------------------------------------------------- *)
+class rewriteVisitor (file : file) (allocs : heap_obj list) (by_id : int -> heap_obj) = object
+  inherit nopCilVisitor
+
+  method vinst (i : instr) =
+    match List.filter (fun a -> a.alloc == i) allocs, i with
+    | a :: _, _ ->
+        let loc = get_instrLoc i in
+        let obj = match a.obj with Some o -> o | None -> assert false in
+        let havoc_fun = findOrCreateFunc file "__CPROVER_havoc_object"
+          (TFun (voidType, Some [("p", voidPtrType, [])], false, [])) in
+        let havoc v = Call (None, Lval (Var havoc_fun, NoOffset), [mkCast (AddrOf (Var v, NoOffset)) voidPtrType], loc) in
+        let havocs =
+          if a.zeroed then []
+          else if a.split then Hashtbl.fold (fun _ v l -> havoc v :: l) a.fields []
+          else [havoc obj]
+        in
+        ChangeTo (Set ((Var a.origin, NoOffset), mkCast (AddrOf (Var obj, NoOffset)) a.origin.vtype, loc) :: havocs)
+    | [], Call (_, Lval (Var f, NoOffset), [arg], _) when f.vname = "free" && tracked_src arg <> None -> ChangeTo []
+    | _ -> DoChildren
+
+  method vlval (lv : lval) =
+    match lv with
+    | (Mem (Lval (Var v, NoOffset)), Field (fi, off)) ->
+        (match pts_of v with
+         | [id] when (by_id id).split && not (Hashtbl.mem unknown v.vid) ->
+             ChangeDoChildrenPost ((Var (Hashtbl.find (by_id id).fields fi.fname), off), fun l -> l)
+         | _ -> DoChildren)
+    | _ -> DoChildren
+end
+
+let () =
+  let (input_file, output_file) =
+    match List.tl (Array.to_list Sys.argv) with
+    | [i; o] -> (i, o)
+    | _ -> Printf.eprintf "Usage: %s <cbmc_ready.i> <output_file>\n" Sys.argv.(0); exit 1
+  in
+  let f = Frontc.parse input_file () in
+
+  let fundecs = Hashtbl.create 17 in
+  iterGlobals f (function GFun (fd, _) -> Hashtbl.replace fundecs fd.svar.vname fd | _ -> ());
+  let found = ref [] in
+  (try ignore (visitCilFunction (new allocVisitor found) (Hashtbl.find fundecs "main"))
+   with Not_found -> ());
+  let allocs = List.rev !found in
+  let by_id id = List.find (fun a -> a.id = id) allocs in
+
+  (* Points-to, to a fixed point over every function *)
+  List.iter (fun a -> add_pts a.origin [a.id]) allocs;
+  changed := true;
+  while !changed do
+    changed := false;
+    iterGlobals f (function
+      | GFun (fd, _) -> ignore (visitCilFunction (new flowVisitor allocs fundecs) fd)
+      | _ -> ())
+  done;
+  let no_split = Hashtbl.create 17 in
+  Hashtbl.iter (fun vid ids ->
+    if List.length ids > 1 || Hashtbl.mem unknown vid then List.iter (fun id -> Hashtbl.replace no_split id ()) ids
+  ) pts;
+  iterGlobals f (function
+    | GFun (fd, _) -> ignore (visitCilFunction (new escapeVisitor allocs fundecs no_split) fd)
+    | _ -> ());
+
+  (* The static objects, named after the pointer main keeps them in (not a CIL temporary) *)
+  let taken = Hashtbl.create 17 in
+  iterGlobals f (function
+    | GVar (vi, _, _) | GVarDecl (vi, _) -> Hashtbl.replace taken vi.vname ()
+    | GFun (fd, _) -> Hashtbl.replace taken fd.svar.vname ()
+    | _ -> ());
+  let rec fresh name = if Hashtbl.mem taken name then fresh (name ^ "_") else (Hashtbl.replace taken name (); name) in
+  let main_vars = try (Hashtbl.find fundecs "main").slocals with Not_found -> [] in
+  let new_globals = Hashtbl.create 17 in      (* compinfo key (or -1) -> globals to add after it *)
+  let add_after key g = Hashtbl.replace new_globals key (g :: (try Hashtbl.find new_globals key with Not_found -> [])) in
+  List.iter (fun a ->
+    let named =
+      try List.find (fun v -> pts_of v = [a.id] && not (Hashtbl.mem unknown v.vid)
+                              && not (String.length v.vname >= 3 && String.sub v.vname 0 3 = "tmp")) main_vars
+      with Not_found -> a.origin in
+    (* A struct object goes right after the struct's definition, which can come before its typedef *)
+    let (otype, key) = match unrollType a.otype with
+      | TComp (ci, _) as t -> (t, ci.ckey)
+      | _ -> (a.otype, -1) in
+    let obj = makeGlobalVar (fresh (named.vname ^ "_obj")) otype in
+    a.obj <- Some obj;
+    (match unrollType a.otype with
+     | TComp (ci, _) when ci.cstruct && not (Hashtbl.mem no_split a.id)
+                          && List.for_all (fun fi -> fi.fbitfield = None && fi.fname <> "") ci.cfields ->
+         a.split <- true;
+         List.iter (fun fi ->
+           let v = makeGlobalVar (fresh (obj.vname ^ "_" ^ fi.fname)) fi.ftype in
+           Hashtbl.replace a.fields fi.fname v;
+           add_after key (GVar (v, { init = None }, locUnknown))
+         ) ci.cfields
+     | _ -> ());
+    add_after key (GVar (obj, { init = None }, locUnknown));
+    Printf.printf "Static: %s%s\n" obj.vname
+      (if a.split then Printf.sprintf " (split into %d variables)" (Hashtbl.length a.fields) else "")
+  ) allocs;
+
+  iterGlobals f (function
+    | GFun (fd, _) -> ignore (visitCilFunction (new rewriteVisitor f allocs by_id) fd)
+    | _ -> ());
+  (* New globals after their struct's definition (the others before the first function), and without the implicit
+     declarations CIL made for cbmc's builtins *)
+  let first_fun = ref true in
+  f.globals <- List.concat (List.map (fun g ->
+    match g with
+    | GCompTag (ci, _) -> g :: List.rev (try Hashtbl.find new_globals ci.ckey with Not_found -> [])
+    | GFun _ when !first_fun -> first_fun := false; List.rev (try Hashtbl.find new_globals (-1) with Not_found -> []) @ [g]
+    | GVarDecl (vi, _) when String.length vi.vname > 10 && String.sub vi.vname 0 10 = "__CPROVER_" -> []
+    | _ -> [g]) f.globals);
+
+  let out_channel = open_out output_file in
+  dumpFile defaultCilPrinter out_channel output_file f;
+  close_out out_channel
@@ -0,0 +1,81 @@
+#ifndef HISTORY_BUFFER_H
+#define HISTORY_BUFFER_H
+
+#include <stdbool.h>
+
+// Fixed-capacity history of the last HISTORY_CAPACITY values, replacing queue.h in the harnesses.
+// The capacity is a power of two so the indices wrap with a mask instead of '%', pushing into a full
+// buffer drops the oldest value without a branch, and nothing here does any I/O. Both points matter
+// in CBMC, where every '%' and printf format ends up in the formula.
+
+#ifndef HISTORY_CAPACITY
+#define HISTORY_CAPACITY 8
+#endif
+#define HISTORY_MASK (HISTORY_CAPACITY - 1u)
+
+// Compile-time check: the array size goes negative when the capacity isn't a power of two.
+typedef char history_capacity_is_a_power_of_two[((HISTORY_CAPACITY & HISTORY_MASK) == 0) ? 1 : -1];
+
+// Declares the history type Name of elements T, and its init/push/pop/peek/get/isEmpty/isFull functions.
+// 'empty' is what peek/pop return on an empty history.
+#define DEFINE_HISTORY(Name, T, empty)                                              \
+typedef struct {                                                                    \
+    T data[HISTORY_CAPACITY];                                                       \
+    unsigned head;  /* index of the oldest value */                                 \
+    unsigned count;                                                                 \
+} Name;                                                                             \
+                                                                                    \
+static inline void init##Name(Name *h) {                                            \
+    h->head = 0;                                                                    \
+    h->count = 0;                                                                   \
+}                                                                                   \
+                                                                                    \
+static inline bool isEmpty##Name(const Name *h) {                                   \
+    return h->count == 0;                                                           \
+}                                                                                   \
+                                                                                    \
+static inline bool isFull##Name(const Name *h) {                                    \
+    return h->count == HISTORY_CAPACITY;                                            \
+}                                                                                   \
+                                                                                    \
+/* Appends a value; when full, the slot written is the oldest one, which is dropped */ \
+static inline void push##Name(Name *h, T value) {                                   \
+    unsigned full = (h->count == HISTORY_CAPACITY);                                 \
+    h->data[(h->head + h->count) & HISTORY_MASK] = value;                           \
+    h->head = (h->head + full) & HISTORY_MASK;                                      \
+    h->count += 1u - full;                                                          \
+}                                                                                   \
+                                                                                    \
+/* Oldest value */                                                                  \
+static inline T peek##Name(const Name *h) {                                         \
+    return (h->count != 0) ? h->data[h->head] : (empty);                            \
+}                                                                                   \
+                                                                                    \
+/* Removes and returns the oldest value */                                          \
+static inline T pop##Name(Name *h) {                                                \
+    T value = peek##Name(h);                                                        \
+    unsigned any = (h->count != 0);                                                 \
+    h->head = (h->head + any) & HISTORY_MASK;                                       \
+    h->count -= any;                                                                \
+    return value;                                                                   \
+}                                                                                   \
+                                                                                    \
+/* Value pushed 'age' pushes ago (0 is the newest), age < count */                  \
+static inline T get##Name(const Name *h, unsigned age) {                            \
+    return h->data[(h->head + h->count - 1u - age) & HISTORY_MASK];                 \
+}
+
+DEFINE_HISTORY(IntHistory, int, -1)
+DEFINE_HISTORY(FloatHistory, float, -1.0f)
+
+// Drop-in names for code written against queue.h (Queue q; initQueue(&q); enqueue(&q, v); peek(&q))
+typedef IntHistory Queue;
+
+static inline void initQueue(Queue *q) { initIntHistory(q); }
+static inline bool isEmpty(Queue *q) { return isEmptyIntHistory(q); }
+static inline bool isFull(Queue *q) { return isFullIntHistory(q); }
+static inline void enqueue(Queue *q, int value) { pushIntHistory(q, value); }
+static inline int dequeue(Queue *q) { return popIntHistory(q); }
+static inline int peek(Queue *q) { return peekIntHistory(q); }
+
+#endif // HISTORY_BUFFER_H
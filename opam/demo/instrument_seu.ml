@@ -2,53 +2,279 @@ open Cil
 open Pretty
 module E = Errormsg
 
-(* Function to check if an expression contains a specific variable *)
-let rec uses_variable (vname : string) (e : exp) : bool =
-  match e with
-  | Lval (Var vi, NoOffset) -> vi.vname = vname
-  | Lval (host, offset) ->
-      (match offset with
-       | Field (fi, _) when fi.fname = vname -> true
-       | Index (idx, _) -> uses_variable vname idx
-       | _ -> false)
-  | BinOp (_, e1, e2, _) -> uses_variable vname e1 || uses_variable vname e2
-  | UnOp (_, e, _) -> uses_variable vname e
-  | AddrOf (Var vi, _) -> vi.vname = vname
-  | CastE (_, e) -> uses_variable vname e
-  | _ -> false
-
 (* Extract lval directly from a Set LHS *)
 let extract_lval_from_lhs (lv : lval) (target_var : string) : lval option =
   match lv with
   | Var vi, _ when vi.vname = target_var -> Some lv
   | _ -> None
 
-(* Extract the first matching lval from expression where variable is used *)
-let rec extract_matching_lval (vname : string) (e : exp) : lval option =
+(* Single walk of an expression: whether it uses the variable (by name, or as a field name),
+   and the first lval it reads, which is what the SEU call gets *)
+let rec scan_use (vname : string) (e : exp) : bool * lval option =
   match e with
-  | Lval lv -> Some lv
+  | Lval (Var vi, NoOffset) -> (vi.vname = vname, Some (Var vi, NoOffset))
+  | Lval ((_, offset) as lv) ->
+      let used =
+        match offset with
+        | Field (fi, _) when fi.fname = vname -> true
+        | Index (idx, _) -> fst (scan_use vname idx)
+        | _ -> false
+      in
+      (used, Some lv)
   | BinOp (_, e1, e2, _) ->
-      (match extract_matching_lval vname e1 with
-       | Some lv -> Some lv
-       | None -> extract_matching_lval vname e2)
-  | UnOp (_, e1, _) -> extract_matching_lval vname e1
-  | CastE (_, e1) -> extract_matching_lval vname e1
-  | _ -> None
+      let (u1, lv1) = scan_use vname e1 in
+      let (u2, lv2) = scan_use vname e2 in
+      (u1 || u2, (match lv1 with Some _ -> lv1 | None -> lv2))
+  | UnOp (_, e1, _) | CastE (_, e1) -> scan_use vname e1
+  | AddrOf (Var vi, _) -> (vi.vname = vname, None)
+  | _ -> (false, None)
+
+(* The variable itself where an expression reads it: its own varinfo, so the flip has its type and
+   follows its renaming (-prime) *)
+class varUseVisitor (vname : string) (found : varinfo option ref) = object
+  inherit nopCilVisitor
+  method vvrbl (vi : varinfo) =
+    if vi.vname = vname && !found = None then found := Some vi;
+    SkipChildren
+end
+
+let var_use (vname : string) (e : exp) : lval option =
+  let found = ref None in
+  ignore (visitCilExpr (new varUseVisitor vname found) e);
+  match !found with Some vi -> Some (Var vi, NoOffset) | None -> None
+
+(* Width in bits of the widest object a flip is made for: the bit positions the verification covers *)
+let target_bits = ref 0
+
+let note_bits (t : typ) : unit =
+  target_bits := max !target_bits (try bitsSizeOf t with SizeOfError _ -> 0)
 
 (* Create the function call simulate_seu_main(&x) dynamically *)
 let create_seu_call (lv : lval) (loc : location) : instr =
+  note_bits intType;
   let seu_fun = findOrCreateFunc dummyFile "simulate_seu_main"
     (TFun(voidType, Some ["arg", TPtr(intType, []), []], false, [])) in
   Call (None, Lval (Var seu_fun, NoOffset), [AddrOf lv], loc)
 
-class seuInstrumentationVisitor (target_var : string) = object
+(* -------------------------------------------------- *)
+(* Access path targets                                *)
+(* -------------------------------------------------- *)
+
+(* Besides a plain variable name, the target can be an access path, so a single field or element is
+   flipped instead of the whole object: "r->internal_pressure", "state.mode", "tire_pressure[2]",
+   "speed_history[k]" (index variable), "speed_history[*]" (any element), "*p", or chains of these.
+   A final "[?]" (ex: "temp_window[?]") flips one element chosen by the solver, see create_indexed_seu_call. *)
+type selector = PDeref | PField of string | PIndex of string | PAnyIndex | PSymIndex
+
+type target = Name of string | Path of string * selector list
+
+let is_ident_char c =
+  (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c = '_'
+
+let parse_target (spec : string) : target =
+  let n = String.length spec in
+  let fail () = Printf.eprintf "Invalid target '%s'\n" spec; exit 1 in
+  let rec skip i = if i < n && spec.[i] = ' ' then skip (i + 1) else i in
+  let ident i =
+    let j = ref i in
+    while !j < n && is_ident_char spec.[!j] do incr j done;
+    if !j = i then fail ();
+    (String.sub spec i (!j - i), !j)
+  in
+  (* A leading '*' applies to the whole postfix chain: *a.b is *(a.b) *)
+  let rec stars i k = let i = skip i in if i < n && spec.[i] = '*' then stars (i + 1) (k + 1) else (i, k) in
+  let (i, nstars) = stars 0 0 in
+  let (root, i) = ident (skip i) in
+  let rec selectors i acc =
+    let i = skip i in
+    if i >= n then List.rev acc
+    else if spec.[i] = '.' then
+      let (f, j) = ident (skip (i + 1)) in selectors j (PField f :: acc)
+    else if i + 1 < n && spec.[i] = '-' && spec.[i + 1] = '>' then
+      let (f, j) = ident (skip (i + 2)) in selectors j (PField f :: PDeref :: acc)
+    else if spec.[i] = '[' then begin
+      let close = try String.index_from spec i ']' with Not_found -> fail () in
+      let idx = String.trim (String.sub spec (i + 1) (close - i - 1)) in
+      if idx = "" then fail ();
+      let sel = if idx = "*" then PAnyIndex else if idx = "?" then PSymIndex else PIndex idx in
+      selectors (close + 1) (sel :: acc)
+    end else fail ()
+  in
+  let sels = selectors i [] in
+  let rec derefs k = if k = 0 then [] else PDeref :: derefs (k - 1) in
+  let sels = sels @ derefs nstars in
+  (match List.rev sels with
+   | _ :: before when List.mem PSymIndex before ->
+       Printf.eprintf "Invalid target '%s': [?] has to be the last selector\n" spec; exit 1
+   | _ -> ());
+  if sels = [] then Name root else Path (root, sels)
+
+(* The access path of a CIL lval: p->f is Mem (p) then .f, and p[i] on a pointer is Mem (p + i) *)
+type access = ADeref | AField of string | AIndex of exp
+
+let rec access_path ((host, off) : lval) : (string * access list) option =
+  let rec offsets = function
+    | NoOffset -> []
+    | Field (fi, o) -> AField fi.fname :: offsets o
+    | Index (e, o) -> AIndex e :: offsets o
+  in
+  let base =
+    match host with
+    | Var vi -> Some (vi.vname, [])
+    | Mem (Lval lv) ->
+        (match access_path lv with Some (r, a) -> Some (r, a @ [ADeref]) | None -> None)
+    | Mem (BinOp ((PlusPI | IndexPI), Lval lv, i, _)) ->
+        (match access_path lv with Some (r, a) -> Some (r, a @ [AIndex i]) | None -> None)
+    | Mem _ -> None
+  in
+  match base with
+  | Some (r, a) -> Some (r, a @ offsets off)
+  | None -> None
+
+let rec strip_casts = function
+  | CastE (_, e) -> strip_casts e
+  | e -> e
+
+let index_matches (idx : string) (e : exp) : bool =
+  match strip_casts (constFold true e) with
+  | Lval (Var vi, NoOffset) -> vi.vname = idx
+  | e' ->
+      (match isInteger e' with
+       | Some v -> (try Int64.of_string idx = v with Failure _ -> false)
+       | None -> false)
+
+let path_matches (root : string) (sels : selector list) (lv : lval) : bool =
+  match access_path lv with
+  | Some (r, accesses) when r = root && List.length accesses = List.length sels ->
+      List.for_all2 (fun sel a ->
+        match sel, a with
+        | PDeref, ADeref -> true
+        | PField f, AField f' -> f = f'
+        | PIndex idx, AIndex e -> index_matches idx e
+        | (PAnyIndex | PSymIndex), AIndex _ -> true
+        | _ -> false
+      ) sels accesses
+  | _ -> false
+
+(* First lval matching the path that the expression reads (or takes the address of), indices and
+   addresses included *)
+let rec find_path_use (root : string) (sels : selector list) (e : exp) : lval option =
+  let first l = List.fold_left (fun acc e -> match acc with Some _ -> acc | None -> find_path_use root sels e) None l in
+  match e with
+  | Lval lv | AddrOf lv | StartOf lv ->
+      if path_matches root sels lv then Some lv else find_lval_use root sels lv
+  | BinOp (_, e1, e2, _) -> first [e1; e2]
+  | UnOp (_, e1, _) | CastE (_, e1) -> find_path_use root sels e1
+  | Question (c, e1, e2, _) -> first [c; e1; e2]
+  | _ -> None
+
+and find_lval_use (root : string) (sels : selector list) ((host, off) : lval) : lval option =
+  let rec in_offset = function
+    | NoOffset -> None
+    | Field (_, o) -> in_offset o
+    | Index (e, o) -> (match find_path_use root sels e with Some _ as r -> r | None -> in_offset o)
+  in
+  match (match host with Mem e -> find_path_use root sels e | Var _ -> None) with
+  | Some _ as r -> r
+  | None -> in_offset off
+
+(* int targets go through simulate_seu_main; a target of any other type, a plain name or a path, gets the sized
+   flip of simulate_seu.h: simulate_seu_main_sized((void * )&x, sizeof(x)) *)
+let create_path_seu_call (lv : lval) (loc : location) : instr =
+  match unrollType (typeOfLval lv) with
+  | TInt ((IInt | IUInt), _) | TEnum _ -> create_seu_call lv loc
+  | t ->
+      note_bits t;
+      let seu_fun = findOrCreateFunc dummyFile "simulate_seu_main_sized"
+        (TFun(voidType, Some [("arg", voidPtrType, []); ("size", uintType, [])], false, [])) in
+      Call (None, Lval (Var seu_fun, NoOffset), [mkCast (AddrOf lv) voidPtrType; SizeOf t], loc)
+
+(* "[?]" targets: every access to an element of the array becomes
+   simulate_seu_main_at(&a[i], i, length), which flips only the element whose index the solver picked once
+   (seu_flip_index in simulate_seu.h). The length comes from the array type. *)
+let create_indexed_seu_call (lv : lval) (loc : location) : instr =
+  let (idx, len) =
+    match removeOffsetLval lv with
+    | (base, Index (idx, NoOffset)) ->
+        (match unrollType (typeOfLval base) with
+         | TArray (_, len, _) -> (idx, (try lenOfArray len with LenOfArray -> -1))
+         | _ -> (idx, -1))
+    | _ -> (zero, -1)
+  in
+  if len < 0 then begin
+    Printf.eprintf "%s: the length of the array isn't known at line %d, use [*] instead of [?]\n"
+      (Pretty.sprint ~width:80 (d_lval () lv)) loc.line;
+    exit 1
+  end;
+  match unrollType (typeOfLval lv) with
+  | TInt ((IInt | IUInt), _) | TEnum _ ->
+      note_bits intType;
+      let seu_fun = findOrCreateFunc dummyFile "simulate_seu_main_at"
+        (TFun(voidType, Some [("arg", TPtr(intType, []), []); ("index", intType, []); ("length", intType, [])], false, [])) in
+      Call (None, Lval (Var seu_fun, NoOffset), [AddrOf lv; idx; integer len], loc)
+  | t ->
+      note_bits t;
+      let seu_fun = findOrCreateFunc dummyFile "simulate_seu_main_sized_at"
+        (TFun(voidType, Some [("arg", voidPtrType, []); ("size", uintType, []);
+                               ("index", intType, []); ("length", intType, [])], false, [])) in
+      Call (None, Lval (Var seu_fun, NoOffset),
+            [mkCast (AddrOf lv) voidPtrType; SizeOf t; idx; integer len], loc)
+
+let rec first_some (f : 'a -> 'b option) (l : 'a list) : 'b option =
+  match l with
+  | [] -> None
+  | x :: rest -> (match f x with Some _ as r -> r | None -> first_some f rest)
+
+(* Instruments one function for its targets: the variable or path itself, plus the aliases it has
+   there when it is reached through pointer parameters (see plan_targets) *)
+class seuInstrumentationVisitor (targets : target list) = object (self)
   inherit nopCilVisitor
   val mutable initialized = false
 
+  (* The lval to flip when an assignment writes a target *)
+  method private written (lv : lval) : (target * lval) option =
+    first_some (fun t ->
+      match t with
+      | Name v -> (match extract_lval_from_lhs lv v with Some l -> Some (t, l) | None -> None)
+      | Path (root, sels) -> if path_matches root sels lv then Some (t, lv) else None
+    ) targets
+
+  (* The lval to flip when an expression reads a target *)
+  method private read (e : exp) : (target * lval) option =
+    first_some (fun t ->
+      let found =
+        match t with
+        | Name v -> (match scan_use v e with (true, found) -> found | (false, _) -> None)
+        | Path (root, sels) -> find_path_use root sels e
+      in
+      match found with Some l -> Some (t, l) | None -> None
+    ) targets
+
+  method private seu_call ((t, lv) : target * lval) (loc : location) : instr =
+    match t with
+    | Path (_, sels) when List.mem PSymIndex sels -> create_indexed_seu_call lv loc
+    | Name _ | Path _ -> create_path_seu_call lv loc
+
+  (* Conditions of if/switch: a plain name is flipped where the condition reads it *)
+  method private cond_use (e : exp) : (target * lval) option =
+    first_some (fun t ->
+      match t with
+      | Name v ->
+          (match scan_use v e with
+           | (true, found) ->
+               let l = match var_use v e with Some _ as l -> l | None -> found in
+               (match l with Some l -> Some (t, l) | None -> None)
+           | (false, _) -> None)
+      | Path (root, sels) ->
+          (match find_path_use root sels e with Some l -> Some (t, l) | None -> None)
+    ) targets
+
   method vstmt (s : stmt) =
     match s.skind with
     | Instr il ->
+        (* Built in reverse and reversed once, so a block costs linear time in its length *)
         let new_instrs = ref [] in
+        let emit i = new_instrs := i :: !new_instrs in
         List.iter (fun i ->
           match i with
           | Set (lv, rhs, loc) ->
@@ -58,76 +284,299 @@ class seuInstrumentationVisitor (target_var : string) = object
                 | Const _ -> true
                 | _ -> false
               in
-              (match extract_lval_from_lhs lv target_var with
-               | Some matched_lv ->
+              (match self#written lv with
+               | Some matched ->
                    if not initialized && is_constant_rhs then
                      initialized <- true (* Skip first init assignment *)
                    else (
-                     new_instrs := !new_instrs @ [create_seu_call matched_lv loc];
+                     emit (self#seu_call matched loc);
                      inserted := true)
                | None -> ());
 
-              if uses_variable target_var rhs then (
-                match extract_matching_lval target_var rhs with
-                | Some matched_lv ->
-                    if not !inserted then
-                      new_instrs := !new_instrs @ [create_seu_call matched_lv loc]
-                | None -> ()
-              );
+              (match self#read rhs with
+               | Some matched when not !inserted ->
+                   emit (self#seu_call matched loc)
+               | _ -> ());
 
-              new_instrs := !new_instrs @ [i]
+              emit i
 
           | Call (_, _, args, loc) ->
-              if List.exists (uses_variable target_var) args then (
-                try
-                  let arg = List.find (uses_variable target_var) args in
-                  match extract_matching_lval target_var arg with
-                  | Some matched_lv ->
-                      new_instrs := !new_instrs @ [create_seu_call matched_lv loc]
-                  | None -> ()
-                with Not_found -> ()
-              );
-              new_instrs := !new_instrs @ [i]
-
-          | _ -> new_instrs := !new_instrs @ [i]
+              (match first_some self#read args with
+               | Some matched -> emit (self#seu_call matched loc)
+               | None -> ());
+              emit i
+
+          | _ -> emit i
         ) il;
-        ChangeTo (mkStmt (Instr !new_instrs))
+        s.skind <- Instr (List.rev !new_instrs);
+        SkipChildren
 
-    | If (cond, b1, b2, loc) when uses_variable target_var cond ->
-        let lv = Var (makeGlobalVar target_var intType), NoOffset in
-        let call = mkStmtOneInstr (create_seu_call lv loc) in
-        ChangeTo (mkStmt (Block (mkBlock [call; s])))
+    | If (cond, b1, b2, loc) ->
+        (match self#cond_use cond with
+         | Some matched ->
+             let call = mkStmtOneInstr (self#seu_call matched loc) in
+             ChangeTo (mkStmt (Block (mkBlock [call; s])))
+         | None -> DoChildren)
 
     | Loop (body, loc, _, _) ->
         ChangeDoChildrenPost(s, fun s' -> s')
 
-    | Switch (exp, body, cases, loc) when uses_variable target_var exp ->
-        let lv = Var (makeGlobalVar target_var intType), NoOffset in
-        let call = mkStmtOneInstr (create_seu_call lv loc) in
-        ChangeTo (mkStmt (Block (mkBlock [call; s])))
+    | Switch (exp, body, cases, loc) ->
+        (match self#cond_use exp with
+         | Some matched ->
+             let call = mkStmtOneInstr (self#seu_call matched loc) in
+             ChangeTo (mkStmt (Block (mkBlock [call; s])))
+         | None -> DoChildren)
 
-    | Return (Some e, loc) when uses_variable target_var e ->
-        (match extract_matching_lval target_var e with
-         | Some matched_lv ->
-             let call = mkStmtOneInstr (create_seu_call matched_lv loc) in
+    | Return (Some e, loc) ->
+        (match self#read e with
+         | Some matched ->
+             let call = mkStmtOneInstr (self#seu_call matched loc) in
              ChangeTo (mkStmt (Block (mkBlock [call; s])))
          | None -> DoChildren)
 
     | _ -> DoChildren
 end
 
-let () =
-  if Array.length Sys.argv <> 4 then (
-    Printf.eprintf "Usage: %s <input_file> <output_file> <variable>\n" Sys.argv.(0);
+(* -------------------------------------------------- *)
+(* Interprocedural targets                            *)
+(* -------------------------------------------------- *)
+
+(* With -entry, the target is the one of the entry function, and the callees are instrumented for the
+   aliases it gets through their parameters: f(&x) makes "*p" the target of f's formal p, f(r) with the
+   target "r->f" makes it "p->f", and f(a) with "a[*]" makes it "p[*]". A "[?]" element isn't followed:
+   the call itself gets its indexed flip. A global plain name stays the target of every function
+   reachable from the entry. *)
+
+class callsVisitor (calls : (varinfo * exp list) list ref) = object
+  inherit nopCilVisitor
+  method vinst i =
+    (match i with
+     | Call (_, Lval (Var vi, NoOffset), args, _) -> calls := (vi, args) :: !calls
+     | _ -> ());
+    SkipChildren
+end
+
+(* Whether the function writes anything besides its own locals: a global, or through a pointer *)
+class nonLocalWriteVisitor (hit : bool ref) = object
+  inherit nopCilVisitor
+  method vinst i =
+    let non_local = function
+      | (Var vi, _) -> vi.vglob
+      | (Mem _, _) -> true
+    in
+    (match i with
+     | Set (lv, _, _) | Call (Some lv, _, _, _) when non_local lv -> hit := true
+     | _ -> ());
+    SkipChildren
+end
+
+let rec take n l = if n = 0 then [] else match l with [] -> [] | x :: rest -> x :: take (n - 1) rest
+let rec drop n l = if n = 0 then l else match l with [] -> [] | _ :: rest -> drop (n - 1) rest
+
+(* Targets of a callee's formals, for one call made by a function instrumented for 'target' *)
+let callee_targets (target : target) (formals : varinfo list) (args : exp list) : target list =
+  let (root, sels) = match target with Name v -> (v, []) | Path (r, sels) -> (r, sels) in
+  let splits =
+    let rec go k = if k > List.length sels then [] else (take k sels, drop k sels) :: go (k + 1) in
+    go 0
+  in
+  let rec pairs fs args =
+    match fs, args with
+    | f :: fs', a :: args' -> (f, a) :: pairs fs' args'
+    | _ -> []
+  in
+  List.concat (List.map (fun (formal, arg) ->
+    List.fold_left (fun acc (prefix, rest) ->
+      match strip_casts arg, rest with
+      (* f(&a[i]) with "a[?]": the simulate_seu_main_at() in front of the call already flips a[i] when i is
+         the chosen element, so the callee's "*p" would only ever flip one that isn't *)
+      | AddrOf _, _ when List.mem PSymIndex prefix -> acc
+      | AddrOf lv, _ when path_matches root prefix lv -> Path (formal.vname, PDeref :: rest) :: acc
+      | Lval lv, PDeref :: rest' when path_matches root prefix lv -> Path (formal.vname, PDeref :: rest') :: acc
+      | StartOf lv, ((PIndex _ | PAnyIndex) as idx) :: rest' when path_matches root prefix lv ->
+          Path (formal.vname, idx :: rest') :: acc
+      | _ -> acc
+    ) [] splits
+  ) (pairs formals args))
+
+(* Targets of every function to instrument, following the calls from the entry function. With a
+   monitor, the functions that can't influence it are dropped: void functions that write nothing but
+   their own locals, and that neither lead to the monitor in the call graph nor are called by it
+   (ex: a display routine that only reads the state). *)
+let plan_targets (file : file) (entry : string) (monitor : string option) (target : target)
+    : (string, target list) Hashtbl.t * (string, unit) Hashtbl.t =
+  let fundecs = Hashtbl.create 64 in
+  iterGlobals file (function GFun (fd, _) -> Hashtbl.replace fundecs fd.svar.vname fd | _ -> ());
+  if not (Hashtbl.mem fundecs entry) then begin
+    Printf.eprintf "Entry function '%s' not found\n" entry;
     exit 1
-  );
-  let input_file = Sys.argv.(1) in
-  let output_file = Sys.argv.(2) in
-  let target_var = Sys.argv.(3) in
-  let f = Frontc.parse input_file () in
-  iterGlobals f (function
-    | GFun (fd, _) -> ignore (visitCilFunction (new seuInstrumentationVisitor target_var) fd)
+  end;
+  let calls_of = Hashtbl.create 64 in
+  Hashtbl.iter (fun name fd ->
+    let calls = ref [] in
+    ignore (visitCilFunction (new callsVisitor calls) fd);
+    Hashtbl.replace calls_of name
+      (List.filter (fun (vi, _) -> Hashtbl.mem fundecs vi.vname) (List.rev !calls))
+  ) fundecs;
+  let callees name = List.map (fun (vi, _) -> vi.vname) (Hashtbl.find calls_of name) in
+
+  (* Functions reachable from the given ones, following 'next' *)
+  let closure (next : string -> string list) (start : string list) : (string, unit) Hashtbl.t =
+    let seen = Hashtbl.create 64 in
+    let rec visit name =
+      if not (Hashtbl.mem seen name) then begin
+        Hashtbl.replace seen name ();
+        List.iter visit (next name)
+      end
+    in
+    List.iter visit start;
+    seen
+  in
+  let reachable = closure callees [entry] in
+
+  let plan = Hashtbl.create 64 in
+  let work = Queue.create () in
+  let add name t =
+    let known = try Hashtbl.find plan name with Not_found -> [] in
+    if not (List.mem t known) then begin
+      Hashtbl.replace plan name (known @ [t]);
+      Queue.add (name, t) work
+    end
+  in
+  add entry target;
+  (match target with
+   | Name v when List.exists (function GVar (vi, _, _) | GVarDecl (vi, _) -> vi.vname = v | _ -> false) file.globals ->
+       Hashtbl.iter (fun name () -> add name target) reachable
+   | _ -> ());
+  while not (Queue.is_empty work) do
+    let (name, t) = Queue.pop work in
+    List.iter (fun (callee, args) ->
+      let fd = Hashtbl.find fundecs callee.vname in
+      List.iter (add callee.vname) (callee_targets t fd.sformals args)
+    ) (Hashtbl.find calls_of name)
+  done;
+
+  (match monitor with
+   | None -> ()
+   | Some m when not (Hashtbl.mem fundecs m) ->
+       Printf.eprintf "Monitor function '%s' not found, nothing pruned\n" m
+   | Some m ->
+       let callers = Hashtbl.create 64 in
+       Hashtbl.iter (fun name _ ->
+         List.iter (fun c -> Hashtbl.add callers c name) (callees name)) calls_of;
+       let leads_to_monitor = closure (Hashtbl.find_all callers) [m] in
+       let called_by_monitor = closure callees [m] in
+       let pruned = ref [] in
+       Hashtbl.iter (fun name _ ->
+         let fd = Hashtbl.find fundecs name in
+         let returns_value =
+           match fd.svar.vtype with
+           | TFun (rt, _, _, _) -> not (isVoidType rt)
+           | _ -> true
+         in
+         let writes = ref returns_value in
+         if not !writes then ignore (visitCilFunction (new nonLocalWriteVisitor writes) fd);
+         if name <> entry && not (Hashtbl.mem leads_to_monitor name || Hashtbl.mem called_by_monitor name || !writes)
+         then pruned := name :: !pruned
+       ) plan;
+       List.iter (Hashtbl.remove plan) !pruned;
+       if !pruned <> [] then
+         Printf.printf "Pruned (can't influence %s): %s\n" m (String.concat ", " (List.sort compare !pruned)));
+  (plan, reachable)
+
+(* -lean: only the functions that can run (all of them, or those reachable from the entry function)
+   and the globals, types and declarations they reference, transitively. The compiler builtin
+   declarations and the rest of the headers are dropped, so the per-variable files stay small for
+   gcc -E and cbmc. *)
+let make_lean (file : file) (keep : string -> bool) : unit =
+  Rmtmps.removeUnusedTemps ~isRoot:(function GFun (fd, _) -> keep fd.svar.vname | _ -> false) file
+
+(* -prime: the globals defined here become the primed side's own copies "<g>_prime", declared extern.
+   compile_safety_cond defines them in the harness with the original initializers, so once this file is
+   appended to the harness (or linked against it) the primed functions neither share the original side's
+   globals nor define one twice. Runs after the instrumentation, which matches the targets by their
+   original names. *)
+let prime_globals (file : file) : string list =
+  let primed = ref [] in
+  file.globals <- List.map (function
+    | GVar (vi, _, loc)
+      when not (String.length vi.vname >= 2 && String.sub vi.vname 0 2 = "__")
+           && vi.vname <> "seu_flip_index" && vi.vname <> "seu_count" ->
+        vi.vname <- vi.vname ^ "_prime";
+        vi.vstorage <- Extern;
+        primed := vi.vname :: !primed;
+        GVarDecl (vi, loc)
+    | g -> g
+  ) file.globals;
+  List.rev !primed
+
+(* -prime: the functions defined here become "<f>_prime". Their calls, prototypes and addresses share the
+   varinfo, so they all follow; the library functions, only declared, keep their names. *)
+let prime_functions (file : file) : string list =
+  let primed = ref [] in
+  iterGlobals file (function
+    | GFun (fd, _) ->
+        fd.svar.vname <- fd.svar.vname ^ "_prime";
+        primed := fd.svar.vname :: !primed
     | _ -> ());
+  List.rev !primed
+
+(* -strip-types: the primed file without its type definitions, to be appended to the harness. The harness
+   is the whole source and already defines them, and CIL's copies can't be defined twice in one unit (an
+   anonymous struct comes back as "struct __anonstruct_T_n"). The file itself keeps them, for the Frama-C
+   re-slice and for compiling it on its own (goto cache). *)
+let strip_types (input_file : string) (output_file : string) : unit =
+  let f = Frontc.parse input_file () in
+  f.globals <- List.filter (function
+    | GType _ | GCompTag _ | GCompTagDecl _ | GEnumTag _ | GEnumTagDecl _ -> false
+    | _ -> true) f.globals;
+  let out_channel = open_out output_file in
+  dumpFile defaultCilPrinter out_channel output_file f;
+  close_out out_channel
+
+let () =
+  (match List.tl (Array.to_list Sys.argv) with
+   | ["-strip-types"; input_file; output_file] -> strip_types input_file output_file; exit 0
+   | _ -> ());
+  let lean = ref false in
+  let prime = ref false in
+  let rec options entry monitor = function
+    | "-entry" :: f :: rest -> options (Some f) monitor rest
+    | "-monitor" :: f :: rest -> options entry (Some f) rest
+    | "-lean" :: rest -> lean := true; options entry monitor rest
+    | "-prime" :: rest -> prime := true; options entry monitor rest
+    | [input_file; output_file; target] -> (entry, monitor, input_file, output_file, target)
+    | _ ->
+        Printf.eprintf "Usage: %s [-entry <function> [-monitor <function>]] [-lean] [-prime] <input_file> <output_file> <variable or access path>\n"
+          Sys.argv.(0);
+        Printf.eprintf "       %s -strip-types <primed_file> <output_file>\n" Sys.argv.(0);
+        exit 1
+  in
+  let (entry, monitor, input_file, output_file, target) =
+    options None None (List.tl (Array.to_list Sys.argv)) in
+  let target = parse_target target in
+  let f = Frontc.parse input_file () in
+  (match entry with
+   | None ->
+       (* Every function, for the target as named there *)
+       iterGlobals f (function
+         | GFun (fd, _) -> ignore (visitCilFunction (new seuInstrumentationVisitor [target]) fd)
+         | _ -> ());
+       if !lean then make_lean f (fun _ -> true)
+   | Some entry ->
+       let (plan, reachable) = plan_targets f entry monitor target in
+       iterGlobals f (function
+         | GFun (fd, _) when Hashtbl.mem plan fd.svar.vname ->
+             ignore (visitCilFunction (new seuInstrumentationVisitor (Hashtbl.find plan fd.svar.vname)) fd)
+         | _ -> ());
+       if !lean then make_lean f (Hashtbl.mem reachable));
+  if !prime then begin
+    let primed = prime_globals f in
+    if primed <> [] then Printf.printf "Primed globals: %s\n" (String.concat ", " primed);
+    Printf.printf "Primed functions: %s\n" (String.concat ", " (prime_functions f))
+  end;
+  if !target_bits > 0 then Printf.printf "Target bits: %d\n" !target_bits;
   let out_channel = open_out output_file in
   dumpFile defaultCilPrinter out_channel output_file f;
   close_out out_channel
@@ -0,0 +1,140 @@
+#ifndef LIBM_MODELS_H
+#define LIBM_MODELS_H
+
+#include <math.h>
+
+// Verification models of the math.h functions the benchmarks call, included by the harness of every source that
+// includes math.h (after it: the libm names below are macros for the models, so the _prime copies appended later
+// call them too). Exact where that is cheap: fabs clears the sign bit, floor/ceil/round go through one
+// integer conversion, fmin/fmax and pow with an exponent of 0, 1 or 2 are plain comparisons and products.
+// Everything else is a sound over-approximation: a nondet result constrained only by properties the real
+// function has (sqrt between 1 and x, sin and cos within [-1, 1], ...), with the NaN and infinity cases kept.
+// No polynomial or iterative algorithm ever reaches the formula.
+
+double nondet_double();
+
+#define seu_is_nan(x) ((x) != (x))
+#define seu_is_finite(x) ((x) - (x) == 0.0)
+
+static inline double seu_fabs(double x) {
+    union { double d; unsigned long long u; } v;
+    v.d = x;
+    v.u &= 0x7fffffffffffffffULL;
+    return v.d;
+}
+
+// Integer part, toward 0, with the sign of x when it is 0 (|x| < 2^52: beyond that, x is already an integer)
+static inline double seu_trunc_small(double x) {
+    double t = (double)(long long)x;
+    return (t == 0.0) ? x * 0.0 : t;
+}
+
+static inline double seu_floor(double x) {
+    if (!(seu_fabs(x) < 4503599627370496.0)) return x;
+    double t = seu_trunc_small(x);
+    return (t > x) ? t - 1.0 : t;
+}
+
+static inline double seu_ceil(double x) {
+    if (!(seu_fabs(x) < 4503599627370496.0)) return x;
+    double t = seu_trunc_small(x);
+    return (t < x) ? t + 1.0 : t;
+}
+
+// Halfway cases away from 0
+static inline double seu_round(double x) {
+    if (!(seu_fabs(x) < 4503599627370496.0)) return x;
+    double t = seu_trunc_small(x);
+    double rest = x - t;
+    if (rest >= 0.5) return t + 1.0;
+    if (rest <= -0.5) return t - 1.0;
+    return t;
+}
+
+static inline double seu_fmin(double a, double b) {
+    if (seu_is_nan(a)) return b;
+    if (seu_is_nan(b)) return a;
+    return (a < b) ? a : b;
+}
+
+static inline double seu_fmax(double a, double b) {
+    if (seu_is_nan(a)) return b;
+    if (seu_is_nan(b)) return a;
+    return (a > b) ? a : b;
+}
+
+static inline double seu_sqrt(double x) {
+    if (seu_is_nan(x) || x < 0.0) return 0.0 / 0.0;
+    if (x == 0.0 || !seu_is_finite(x)) return x;
+    double r = nondet_double();
+    __CPROVER_assume(x >= 1.0 ? (r >= 1.0 && r <= x) : (r >= x && r <= 1.0));
+    return r;
+}
+
+static inline double seu_sin(double x) {
+    if (!seu_is_finite(x)) return 0.0 / 0.0;
+    if (x == 0.0) return x;
+    double r = nondet_double();
+    __CPROVER_assume(r >= -1.0 && r <= 1.0 && seu_fabs(r) <= seu_fabs(x));
+    return r;
+}
+
+static inline double seu_cos(double x) {
+    if (!seu_is_finite(x)) return 0.0 / 0.0;
+    if (x == 0.0) return 1.0;
+    double r = nondet_double();
+    __CPROVER_assume(r >= -1.0 && r <= 1.0);
+    return r;
+}
+
+static inline double seu_pow(double x, double y) {
+    if (y == 0.0) return 1.0;
+    if (y == 1.0) return x;
+    if (y == 2.0) return x * x;
+    return nondet_double();
+}
+
+static inline double seu_exp(double x) {
+    if (seu_is_nan(x)) return x;
+    double r = nondet_double();
+    __CPROVER_assume(r >= 0.0 && (x < 0.0 ? r <= 1.0 : r >= 1.0));
+    return r;
+}
+
+// float variants: the double model, rounded once (exact for fabs, floor, ceil and round)
+static inline float seu_fabsf(float x) { return (float)seu_fabs(x); }
+static inline float seu_floorf(float x) { return (float)seu_floor(x); }
+static inline float seu_ceilf(float x) { return (float)seu_ceil(x); }
+static inline float seu_roundf(float x) { return (float)seu_round(x); }
+static inline float seu_fminf(float a, float b) { return (float)seu_fmin(a, b); }
+static inline float seu_fmaxf(float a, float b) { return (float)seu_fmax(a, b); }
+static inline float seu_sqrtf(float x) { return (float)seu_sqrt(x); }
+static inline float seu_sinf(float x) { return (float)seu_sin(x); }
+static inline float seu_cosf(float x) { return (float)seu_cos(x); }
+static inline float seu_powf(float x, float y) { return (float)seu_pow(x, y); }
+static inline float seu_expf(float x) { return (float)seu_exp(x); }
+
+#define fabs seu_fabs
+#define floor seu_floor
+#define ceil seu_ceil
+#define round seu_round
+#define fmin seu_fmin
+#define fmax seu_fmax
+#define sqrt seu_sqrt
+#define sin seu_sin
+#define cos seu_cos
+#define pow seu_pow
+#define exp seu_exp
+#define fabsf seu_fabsf
+#define floorf seu_floorf
+#define ceilf seu_ceilf
+#define roundf seu_roundf
+#define fminf seu_fminf
+#define fmaxf seu_fmaxf
+#define sqrtf seu_sqrtf
+#define sinf seu_sinf
+#define cosf seu_cosf
+#define powf seu_powf
+#define expf seu_expf
+
+#endif // LIBM_MODELS_H
@@ -2,6 +2,56 @@ open Cil
 
 module StringSet = Set.Make(String)
 
+(* Globals read by a function: as values, through their address, or in the address of a write *)
+class globalReadsVisitor (reads : StringSet.t ref) = object
+  inherit nopCilVisitor
+  method vexpr e =
+    (match e with
+     | Lval (Var vi, _) | AddrOf (Var vi, _) | StartOf (Var vi, _)
+       when vi.vglob && not (isFunctionType vi.vtype) ->
+         reads := StringSet.add vi.vname !reads
+     | _ -> ());
+    DoChildren
+end
+
+class callsVisitor (callees : StringSet.t ref) = object
+  inherit nopCilVisitor
+  method vinst i =
+    (match i with
+     | Call (_, Lval (Var vi, NoOffset), _, _) -> callees := StringSet.add vi.vname !callees
+     | _ -> ());
+    DoChildren
+end
+
+(* Globals read by the function or by any function it calls, directly or not. Globals that are only
+   written, or not used at all, can't change what the function computes and are left out. *)
+let global_reads (file : file) (fd : fundec) : StringSet.t =
+  let fundecs = Hashtbl.create 64 in
+  iterGlobals file (function GFun (f, _) -> Hashtbl.replace fundecs f.svar.vname f | _ -> ());
+  let seen = Hashtbl.create 64 in
+  let reads = ref StringSet.empty in
+  let rec visit (f : fundec) =
+    if not (Hashtbl.mem seen f.svar.vname) then begin
+      Hashtbl.replace seen f.svar.vname ();
+      ignore (visitCilFunction (new globalReadsVisitor reads) f);
+      let callees = ref StringSet.empty in
+      ignore (visitCilFunction (new callsVisitor callees) f);
+      StringSet.iter (fun name ->
+        try visit (Hashtbl.find fundecs name) with Not_found -> ()) !callees
+    end
+  in
+  visit fd;
+  !reads
+
+(* Globals the source file itself defines. Those of the headers (stdout, stderr, ...) are only declared
+   in the file, or defined in a header, and can't be SEU targets of the program. *)
+let source_globals (file : file) : StringSet.t =
+  List.fold_left (fun acc g ->
+    match g with
+    | GVar (vi, _, loc) when not (Filename.check_suffix loc.file ".h") -> StringSet.add vi.vname acc
+    | _ -> acc
+  ) StringSet.empty file.globals
+
 let () =
   if Array.length Sys.argv <> 4 then begin
     Printf.eprintf
@@ -28,6 +78,8 @@ let () =
             StringSet.empty
             (fd.sformals @ fd.slocals)
         in
+        let globals = StringSet.inter (global_reads file fd) (source_globals file) in
+        let vars = StringSet.union vars globals in
 
         (* Write to output file *)
         let oc = open_out output_file in
@@ -37,8 +89,10 @@ let () =
         close_out oc;
 
         Printf.printf
-          "Written %d variables to %s\n"
+          "Written %d variables (%d globals read by %s or its callees) to %s\n"
           (StringSet.cardinal vars)
+          (StringSet.cardinal globals)
+          target_fun
           output_file
 
     | _ -> ()
@@ -5,8 +5,28 @@ mode="$1"
 source_file="/home/opam/demo/problems/cs1_org.c"			#Source file path - absolute file path.
 entry_func="p"								#Entry point of the main function to add assertions to.
 slice_var="output"							#Variable with respect to which slicing is to be done.
-line_num=38								#The line at which entry func is called. Safety condition is inserted right below this line.
-safety_cond_file=""							#Absolute path to the .txt file condition the safety condition
+slice_from_cond=1							#1: slice on what the safety condition reads (one combined slice), slice_var when it reads nothing of the entry function.
+slicing_level=3								#Frama-C slicing level (0 to 3).
+extra_targets=()							#Access paths checked as targets of their own, ex: ("r->internal_pressure" "speed_history[?]").
+monitor_func=""								#Function checking the safety invariants (ex: "monitor_safety_invariants"), callees that can't influence it aren't instrumented.
+lean_cil=1								#1: the instrumented files only keep the functions that can run and what they reference (no compiler builtins).
+reslice=0								#1: slice every instrumented file again on the slicing criteria, dropping the flips that can't reach them.
+safety_cond_file="/home/opam/demo/problems/cs1_org_safety_cond.txt"	#Absolute path to the .txt file containing the safety condition ("<name>: <expression>" per line)
+diff_window=0								#Steps over which the original and primed outputs are compared (diff_monitor.h), 0 is off.
+diff_threshold=0							#Diverging steps among the last diff_window that fail the divergence property (0: all of them).
+verify_mode="bmc"							#CBMC verification mode used in STEP 8: "bmc" or "kind" (k-induction).
+verify_unwind=""							#Unwinding bound for cbmc, empty lets cbmc unwind until the loops terminate.
+verify_k=1								#Induction depth for "kind" mode (raised automatically for windowed conditions).
+goto_cache=0								#1: compile the shared harness to a goto binary once and link each _prime function against it.
+solver_portfolio=""							#Comma separated solver backends to race per cbmc call (ex: "minisat,cadical,z3"), empty for cbmc's default.
+partition_bits=1							#Number of sub-queries the injected bit range is split into (bmc mode).
+partition_preds=()							#Predicates over the inputs at the entry call to split on, ex: ("x > 10" "y == 1").
+eva_prescreen=0								#1: Eva pre-screens every bit position (prescreen_bits.sh), cbmc only checks the bits not proven masked.
+fixed_point=0								#1: first verify the float programs in fixed point (float_to_fixed.ml), a CRV found there is checked again in float at its bit. Float targets aren't screened.
+fixed_frac_bits=16							#Fractional bits of the fixed-point values.
+fixed_eps=64								#Error bound declared for the fixed-point values, in units of 2^-fixed_frac_bits (comparisons closer than that are left open).
+narrow_width=0								#8 or 16: first verify with the program's int variables narrowed to that width (narrow_width.ml), a CRV found there is final. 0 is off.
+heap_to_static=0							#1: main's single-instance heap objects become static, their structs split into one variable per field (heap_to_static.ml).
 
 #Output files get created in following folders:
 # /home/opam/demo/problems/cs1_org			=>is the main output dir, contains sliced file, special file with mappings (var_name, identity_num).
@@ -29,12 +49,58 @@ if [ "$mode" != "testing" ]; then
 
 	echo "Enter the variable w.r.t slice the entry function"
 	read slice_var
+
+	echo "Enter the path to the safety condition.txt file"
+	read safety_cond_file
 fi
 filename=$(basename "$output_dir")
 sliced_file="${output_dir}/${filename}_frama_sliced.c"
+
+#Slicing criteria: what the safety condition reads from the entry function (its result, the objects or fields behind its
+#pointer parameters, globals), given to a single Frama-C run instead of one slice per variable. slice_var otherwise.
+slice_criteria=(-slice-value "${slice_var}")
+reslice_criteria=("${slice_criteria[@]}")		#Same criteria on the instrumented files, where the globals are "<g>_prime".
+if [ "${slice_from_cond}" = "1" ]; then
+	eval $(opam env --switch=cil-switch --set-switch)
+	ocamlfind ocamlopt -package cil -linkpkg -o compile_safety_cond /home/opam/demo/compile_safety_cond.ml > /dev/null 2>&1
+	source_i="${output_dir}/${filename}_source.i"
+	gcc -E "${source_file}" -o "${source_i}" > /dev/null 2>&1
+	criteria=$(./compile_safety_cond -criteria "${source_file}" "${source_i}" "${entry_func}" "${safety_cond_file}" 2> /dev/null)
+	if [ -n "${criteria}" ]; then
+		slice_criteria=()
+		grep -q -x "return" <<< "${criteria}" && slice_criteria+=(-slice-return "${entry_func}")
+		slice_values=$(grep -v -x "return" <<< "${criteria}" | paste -s -d, -)
+		[ -n "${slice_values}" ] && slice_criteria+=(-slice-value "${slice_values}")
+		echo "[+] Slicing criteria from the safety condition: ${slice_criteria[*]}"
+		#The instrumented files call the entry function "<entry>_prime", and the globals are the criteria that are neither
+		#"*p" nor "p->f" of a parameter.
+		reslice_criteria=()
+		for criterion in "${slice_criteria[@]}"; do
+			[ "${criterion}" = "${entry_func}" ] && criterion="${entry_func}_prime"
+			reslice_criteria+=("${criterion}")
+		done
+		if [ -n "${slice_values}" ]; then
+			reslice_values=$(tr ',' '\n' <<< "${slice_values}" | sed -E '/^\*|->/!s/^([A-Za-z_][A-Za-z0-9_]*)/\1_prime/' | paste -s -d, -)
+			reslice_criteria=("${reslice_criteria[@]:0:${#reslice_criteria[@]}-1}" "${reslice_values}")
+		fi
+	fi
+fi
 echo "[+] Switching to Frama-C OPAM Switch..."
 eval $(opam env --switch=frama-switch --set-switch)
-frama-c -load-module slicing "${source_file}" -main "${entry_func}" -slice-value "${slice_var}" -slicing-level 3 -then-on 'Slicing export' -print -ocode "${sliced_file}" > /dev/null 2>&1
+#Saved Frama-C session: the source is parsed and analyzed by Eva once per (source, entry function), and every slice of it
+#(other criteria, other slicing levels, later runs) loads that state, so only the slicing itself is paid again. The
+#session is redone when the source is newer than it.
+frama_session="${output_dir}/${filename}_${entry_func}.sav"
+if [ ! -f "${frama_session}" ] || [ "${source_file}" -nt "${frama_session}" ]; then
+	frama-c -load-module slicing "${source_file}" -main "${entry_func}" -eva -save "${frama_session}" > /dev/null 2>&1
+	echo "[+] Frama-C session saved: ${frama_session}"
+fi
+rm -f "${sliced_file}"
+frama-c -load-module slicing -load "${frama_session}" "${slice_criteria[@]}" -slicing-level "${slicing_level}" -then-on 'Slicing export' -print -ocode "${sliced_file}" > /dev/null 2>&1
+if [ ! -s "${sliced_file}" ]; then
+	echo "[-] Slicing from the saved session failed, slicing from the source"
+	frama-c -load-module slicing "${source_file}" -main "${entry_func}" "${slice_criteria[@]}" -slicing-level "${slicing_level}" -then-on 'Slicing export' -print -ocode "${sliced_file}" > /dev/null 2>&1
+fi
 echo "Static slicing performed, file stored at ${sliced_file}"
 
 
@@ -55,6 +121,7 @@ echo "Temporary txt file with unique variable names written to: ${tmp_uniq_vars_
 
 #writing mappings to the final txt file.
 mapfile -t vars < "$tmp_uniq_vars_txt"
+vars+=("${extra_targets[@]}")
 : > "$final_uniq_vars_txt"
 for i in "${!vars[@]}"; do
     printf "vars[%d] = %s\n" "$i" "${vars[$i]}" >> "$final_uniq_vars_txt"
@@ -67,6 +134,67 @@ echo "Final indexed variables written to: ${final_uniq_vars_txt}"
 
 ################# STEP 5: Creating the Instrumentation Executable, instrumented code, cbmc ready code ######################
 ocamlfind ocamlopt -package cil -linkpkg -o instrument_seu /home/opam/demo/instrument_seu.ml > /dev/null 2>&1
+#Creating the harness shared by every variable: the original source with the SEU/Queue includes and the Queue
+#initialization in main. It doesn't depend on the variable, so it is built once per source.
+harness_file="${output_dir}/${filename}_harness.c"
+cp "${source_file}" "${harness_file}"
+#Sources using math.h get the cheap libm models (libm_models.h) in place of the library functions. The I/O, logging
+#and delay calls always go through the stubs of io_stubs.h, included last.
+uses_libm=0
+grep -q -E '^[[:space:]]*#[[:space:]]*include[[:space:]]*<math\.h>' "${source_file}" && uses_libm=1
+awk -v uses_libm="${uses_libm}" '
+  /^#include/ { last_include = NR }
+  { lines[NR] = $0 }
+  END {
+    for (i = 1; i <= NR; i++) {
+      print lines[i]
+      if (i == last_include) {
+	print "#include \"/home/opam/demo/simulate_seu.h\""
+	print "#include \"/home/opam/demo/history_buffer.h\""
+	print "#include \"/home/opam/demo/temporal_monitor.h\""
+	print "#include \"/home/opam/demo/diff_monitor.h\""
+	if (uses_libm) print "#include \"/home/opam/demo/libm_models.h\""
+	print "#include \"/home/opam/demo/io_stubs.h\""
+      }
+    }
+  }
+' "${harness_file}" > "${harness_file}.tmp" && mv "${harness_file}.tmp" "${harness_file}"
+
+awk -v entry_func="${entry_func}" '
+  BEGIN {
+    in_main_body = 0
+    main_depth = 0
+    main_opened = 0
+  }
+
+  # Detect main function signature
+  /^[[:space:]]*(int|void)[[:space:]]+main[[:space:]]*\(/ {
+    in_main_body = 1
+  }
+
+  {
+    # Assume the input cube of a partitioned sub-query right before the entry function is called
+    if (in_main_body && $0 ~ ("(^|[^A-Za-z0-9_])" entry_func "[[:space:]]*\\(")) {
+      match($0, /^[[:space:]]*/)
+      print substr($0, 1, RLENGTH) "SEU_CUBE_ASSUME();"
+    }
+
+    # main ends at the brace that closes its body: calls of the entry function after it get no cube
+    if (in_main_body) {
+      line = $0
+      opens = gsub(/\{/, "", line)
+      closes = gsub(/\}/, "", line)
+      main_depth += opens - closes
+      if (opens > 0) main_opened = 1
+      if (main_opened && main_depth <= 0) in_main_body = 0
+    }
+
+    print
+  }
+' "${harness_file}" > "${harness_file}.tmp" && mv "${harness_file}.tmp" "${harness_file}"
+sed -i 's/\r$//' "${harness_file}"
+echo "Harness created: ${harness_file}"
+
 #iterating on all the folders(the numbers) and then creating the instrumented file within that folder.
 for i in "${!vars[@]}";do
 	folder_path="${output_dir}/${i}"
@@ -75,79 +203,260 @@ for i in "${!vars[@]}";do
 
 	instru="${folder_path}/${filename}_instru.c"				#Filename for instrumented code.
 	instru_clean="${folder_path}/${filename}_instru_cleaned.c"		#Filename for instrumented and cleaned code.
+	instru_append="${folder_path}/${filename}_instru_append.c"		#The same without its type definitions.
 	final_output="${folder_path}/${filename}_cbmc_start.c"			#Filename for the final file to be used by cbmc.
 
-	./instrument_seu "${sliced_file}" "${instru}" "${vars[$i]}"
+	instrument_args=(-entry "${entry_func}" -prime)		#The functions become "<f>_prime", with their own "<g>_prime" globals.
+	[ -n "${monitor_func}" ] && instrument_args+=(-monitor "${monitor_func}")
+	[ "${lean_cil}" = "1" ] && instrument_args+=(-lean)
+	./instrument_seu "${instrument_args[@]}" "${sliced_file}" "${instru}" "${vars[$i]}" | tee "${folder_path}/${filename}_instru.log"
 	echo "Finished instrumentation, sliced_file used: ${sliced_file}, created: ${instru}, variable instrumented: ${vars[$i]}"
 
-	gcc -E -P "${instru}" -o  "${instru_clean}" > /dev/null 2>&1
+	#Second slice, per variable: the SEU calls are seen through their ACSL contracts (a flip changes the target from its
+	#own value), so only the flips that can reach the slicing criteria are kept, with the statements they need. When none is
+	#left the flip can't change the output and the variable is NOT_CRV without running cbmc (STEP 8).
+	rm -f "${folder_path}/no_flip"
+	if [ "${reslice}" = "1" ]; then
+		reslice_input="${folder_path}/${filename}_instru_spec.c"
+		resliced="${folder_path}/${filename}_instru_resliced.c"
+		cat /home/opam/demo/simulate_seu_acsl.h "${instru}" > "${reslice_input}"
+		eval $(opam env --switch=frama-switch --set-switch)
+		frama-c -load-module slicing "${reslice_input}" -main "${entry_func}_prime" "${reslice_criteria[@]}" -slicing-level "${slicing_level}" -then-on 'Slicing export' -print -ocode "${resliced}" > /dev/null 2>&1
+		eval $(opam env --switch=cil-switch --set-switch)
+		if [ ! -s "${resliced}" ]; then
+			echo "[-] Re-slicing failed, keeping ${instru}"
+		elif grep -q -E '^[[:space:]]+simulate_seu_main[a-z_]*[[:space:]]*\(' "${resliced}"; then
+			instru="${resliced}"
+			echo "[+] Re-sliced: ${resliced}"
+		else
+			touch "${folder_path}/no_flip"
+			echo "[+] No flip of ${vars[$i]} reaches the slicing criteria"
+		fi
+	fi
 
-	#Appending '_sliced' to the function name in the cleaned file.
-	sed -i -E 's/^([A-Za-z]+[[:space:]]+)([A-Za-z0-9_]+)\(/\1\2_prime(/' "${instru_clean}" > /dev/null 2>&1
+	gcc -E -P "${instru}" -o  "${instru_clean}" > /dev/null 2>&1
 	echo "Finished instrumentation and cleaning. File available at ${instru_clean}"
 
 
-	#Creating the final cbmc ready file.
-	cp "${source_file}" "${final_output}"
-	awk '
-	  /^#include/ { last_include = NR }
-	  { lines[NR] = $0 }
-	  END {
-	    for (i = 1; i <= NR; i++) {
-	      print lines[i]
-	      if (i == last_include) {
-		print "#include \"/home/opam/demo/simulate_seu.h\""
-		print "#include \"/home/opam/demo/queue.h\""
-	      }
-	    }
-	  }
-	' "${final_output}" > "${final_output}.tmp" && mv "${final_output}.tmp" "${final_output}"
-
-	awk '
-	  BEGIN {
-	    in_main = 0
-	    inserted = 0
-	  }
-
-	  # Detect main function signature
-	  /^[[:space:]]*(int|void)[[:space:]]+main[[:space:]]*\(/ {
-	    in_main = 1
-	  }
-
-	  {
-	    print
-
-	    # Insert immediately after the opening brace of main
-	    if (in_main && !inserted && /\{/) {
-	      print "    Queue q1;"
-	      print "    initQueue(&q1);"
-	      print "    Queue q2;"
-	      print "    initQueue(&q2);"
-	      print ""
-	      inserted = 1
-	      in_main = 0
-	    }
-	  }
-	' "${final_output}" > "${final_output}.tmp" && mv "${final_output}.tmp" "${final_output}"
-
+	#Creating the final cbmc ready file: the shared harness with the instrumented function appended, without the type
+	#definitions the harness already has.
+	./instrument_seu -strip-types "${instru_clean}" "${instru_append}"
+	cp "${harness_file}" "${final_output}"
 	echo -e "\n\n// ----- Renamed Instrumented Function -----\n" >> "${final_output}"
-	sed -i 's/\r$//' "${final_output}"
-	cat "${instru_clean}" >> "${final_output}"
+	cat "${instru_append}" >> "${final_output}"
 
 	echo "[+] CBMC ready file created: ${final_output}"
 done
 
 
-################# STEP 7: Adding the Safety Condition Relevant file into CBMC Ready File ###################################
-if [ "$mode" != "testing" ]; then
-	echo "Enter the line number in file: ${source_file} at which the entry function is being called"
-	read line_num 
-	line_num=${line_num}+6		#Add '2' to account for insertion of the 2 include .h lines.
+################# STEP 7: Compiling the Safety Condition into the Harness, creating the CBMC Ready Files ######################
+#The safety condition file has one "<name>: <C expression>" invariant per line, over the variables of main at the entry
+#function call. compile_safety_cond checks every identifier against the symbols of main, adds the call to the _prime
+#function, and inserts one SEU_PROPERTY per invariant (original holds => primed holds) at the earliest point where
+#every value it reads is final.
+#With diff_window > 0 it also compares both outputs after every call and adds an "output_divergence" property that
+#fails once they have differed on diff_threshold of the last diff_window steps.
+#The longest window the properties read comes back as "WINDOW: n" and sets the induction depth of STEP 8 (--window).
+ocamlfind ocamlopt -package cil -linkpkg -o compile_safety_cond /home/opam/demo/compile_safety_cond.ml > /dev/null 2>&1
+
+harness_i="${output_dir}/${filename}_harness.i"
+harness_ready="${output_dir}/${filename}_harness_ready.c"
+safety_cond_log="${output_dir}/${filename}_safety_cond.log"
+verify_harness="${harness_file}"
+safety_window=0
+gcc -E "${harness_file}" -o "${harness_i}" > /dev/null 2>&1
+./compile_safety_cond -diff "${diff_window}" -diff-threshold "${diff_threshold}" "${harness_file}" "${harness_i}" "${entry_func}" "${safety_cond_file}" "${harness_ready}" > "${safety_cond_log}" 2>&1
+safety_cond_status=$?
+grep -v '^WINDOW: ' "${safety_cond_log}"
+if [ "$safety_cond_status" -eq 0 ]; then
+	verify_harness="${harness_ready}"
+	safety_window=$(sed -n 's/^WINDOW: //p' "${safety_cond_log}")
+	for i in "${!vars[@]}";do
+		folder_path="${output_dir}/${i}"
+		final_cbmc_ready="${folder_path}/${filename}_cbmc_ready.c"
+		cp "${harness_ready}" "${final_cbmc_ready}"
+		echo -e "\n\n// ----- Renamed Instrumented Function -----\n" >> "${final_cbmc_ready}"
+		cat "${folder_path}/${filename}_instru_append.c" >> "${final_cbmc_ready}"
+		echo "[+] CBMC ready file created: ${final_cbmc_ready}"
+	done
+else
+	echo "[-] Safety condition could not be compiled, verifying the _cbmc_start.c files instead"
+fi
 
-	echo "Enter the path to the safety condition.txt file"
-	read safety_cond_file
+
+################# STEP 8: Verifying each CBMC Ready File, writing the CRV verdicts ##########################################
+crv_results_txt="${output_dir}/crv_results.txt"
+crv_matrix_txt="${output_dir}/crv_matrix.txt"
+tmp_properties_txt="${output_dir}/tmp_properties.txt"
+: > "$crv_results_txt"
+: > "$tmp_properties_txt"
+
+#With the goto cache, the original program (the harness) goes through the CBMC front-end and goto conversion only once
+#per source. Each variable then only compiles its own _prime function and links it against the cached binary.
+harness_gb="${output_dir}/${filename}_harness.gb"
+if [ "${partition_bits}" -gt 1 ] || [ ${#partition_preds[@]} -gt 0 ] || [ "${eva_prescreen}" = "1" ]; then
+	goto_cache=0		#The sub-queries are set up with -D, so they need the C file.
+fi
+#heap_to_static.ml rewrites the preprocessed program: the screening runs always use it, the full runs only when they
+#need no -D set-up (partitioned sub-queries, Eva bit ranges), in place of the goto cache.
+static_full=0
+if [ "${heap_to_static}" = "1" ]; then
+	ocamlfind ocamlopt -package cil -linkpkg -o heap_to_static /home/opam/demo/heap_to_static.ml > /dev/null 2>&1
+	if [ "${partition_bits}" -le 1 ] && [ ${#partition_preds[@]} -eq 0 ] && [ "${eva_prescreen}" != "1" ]; then
+		goto_cache=0
+		static_full=1
+	fi
 fi
+if [ "${goto_cache}" = "1" ]; then
+	if goto-cc -c "${verify_harness}" -o "${harness_gb}" > "${harness_gb}.log" 2>&1; then
+		echo "[+] Harness compiled once to goto binary: ${harness_gb}"
+	else
+		goto_cache=0		#Every variable goes through its C file.
+		echo "[-] goto-cc failed on ${verify_harness} (see ${harness_gb}.log), verifying the C files instead"
+	fi
+fi
+if [ "${fixed_point}" = "1" ]; then
+	ocamlfind ocamlopt -package cil -linkpkg -o float_to_fixed /home/opam/demo/float_to_fixed.ml > /dev/null 2>&1
+fi
+if [ "${narrow_width}" != "0" ]; then
+	ocamlfind ocamlopt -package cil -linkpkg -o narrow_width /home/opam/demo/narrow_width.ml > /dev/null 2>&1
+fi
+#Eva pre-screening: a bit whose flip provably keeps every property true is masked and never reaches cbmc. The bits Eva
+#finds violating go first, the ones it can't decide after them.
+if [ "${eva_prescreen}" = "1" ]; then
+	echo "[+] Switching to Frama-C OPAM Switch..."
+	eval $(opam env --switch=frama-switch --set-switch)
+fi
+
+#Preprocesses verify_input into $1 with the gcc options that follow, and moves its heap objects to static storage
+#when heap_to_static is on.
+prepare_input() {
+	local output="$1"
+	shift
+	gcc -E "$@" "${verify_input}" -o "${output}" > /dev/null 2>&1
+	if [ "${heap_to_static}" = "1" ] && ./heap_to_static "${output}" "${output}.static" > /dev/null; then
+		mv "${output}.static" "${output}"
+	fi
+}
+
 for i in "${!vars[@]}";do
 	folder_path="${output_dir}/${i}"
-	final_cbmc_ready="${folder_path}/${filename}_cbmc_ready.c"
+	verify_input="${folder_path}/${filename}_cbmc_ready.c"
+	if [ ! -f "${verify_input}" ]; then
+		verify_input="${folder_path}/${filename}_cbmc_start.c"
+	fi
+
+	target_bits=$(sed -n 's/^Target bits: //p' "${folder_path}/${filename}_instru.log")		#Bits of the flipped target.
+	verify_args=(--mode "${verify_mode}" --k "${verify_k}" --window "${safety_window:-0}" --bit-width "${target_bits:-32}")
+	[ -n "${verify_unwind}" ] && verify_args+=(--unwind "${verify_unwind}")
+	[ -n "${solver_portfolio}" ] && verify_args+=(--portfolio "${solver_portfolio}" --winner-db "${output_dir}/solver_winners.txt")
+	verify_args+=(--properties "${folder_path}/${filename}_properties.txt")
+	screen_args=("${verify_args[@]}" --source "${verify_input}")		#Screening runs, on rewritten copies of verify_input.
+	if [ "${verify_mode}" = "bmc" ]; then		#k-induction doesn't partition.
+		verify_args+=(--bit-parts "${partition_bits}")
+		for pred in "${partition_preds[@]}"; do
+			verify_args+=(--split-on "${pred}")
+		done
+	fi
+	verify_out=""
+	if [ -f "${folder_path}/no_flip" ]; then
+		verify_out="VERDICT: NOT_CRV"
+		: > "${folder_path}/${filename}_properties.txt"
+	fi
+	if [ "${eva_prescreen}" = "1" ] && [ -z "${verify_out}" ]; then
+		check_bits=$(/home/opam/demo/prescreen_bits.sh "${verify_input}" --bits "1-${target_bits:-32}" --out "${folder_path}/${filename}_bits.txt" | sed -n 's/^CHECK BITS: //p')
+		[ "${verify_mode}" = "bmc" ] && verify_args+=(--bits "${check_bits}")		#kind: only the all-masked case is used.
+		echo "[+] ${vars[$i]}: bits left for cbmc: ${check_bits:-none}"
+		if [ -z "${check_bits}" ]; then
+			verify_out="VERDICT: NOT_CRV"
+			: > "${folder_path}/${filename}_properties.txt"
+		fi
+	fi
+	#Fixed-point screening: floats and doubles as scaled integers (fixed_point.h). The fixed program only approximates the
+	#float one, so its verdict is never final: the bit of a fixed CRV is checked alone in float, and a CRV there is final.
+	#Anything else goes on to the float runs.
+	if [ "${fixed_point}" = "1" ] && [ -z "${verify_out}" ]; then
+		fixed_i="${folder_path}/${filename}_fixed.i"
+		fixed_c="${folder_path}/${filename}_fixed.c"
+		prepare_input "${fixed_i}"
+		if ./float_to_fixed -frac "${fixed_frac_bits}" -eps "${fixed_eps}" "${fixed_i}" "${fixed_c}"; then
+			fixed_bit=$(/home/opam/demo/verify_crv.sh "${fixed_c}" "${screen_args[@]}" --flip-bit | sed -n 's/^FLIP BIT: //p')
+			if [ -n "${fixed_bit}" ]; then
+				fixed_out=$(/home/opam/demo/verify_crv.sh "${verify_input}" "${screen_args[@]}" --mode bmc --bits "${fixed_bit}")
+			fi
+			if [ -n "${fixed_bit}" ] && grep -q -x "VERDICT: CRV" <<< "${fixed_out}"; then
+				verify_out="${fixed_out}"
+				sed -i 's/ SUCCESS$/ UNKNOWN/' "${folder_path}/${filename}_properties.txt"
+				echo "[+] ${vars[$i]}: CRV in fixed point, confirmed in float at bit ${fixed_bit}"
+			else
+				echo "[+] ${vars[$i]}: no CRV confirmed from fixed point, verifying in float"
+			fi
+		fi
+	fi
+	#Reduced-width screening: the product program with its int variables narrowed to narrow_width bits, and the narrow sign
+	#bit left out of the flips (positions 1..narrow_width-1, the same low bits as positions 1..narrow_width-1 of the
+	#full-width run). A CRV found there is a CRV at full width; anything else goes on to the full-width run. The
+	#properties that held there only hold at that width, so they are reported unknown.
+	if [ "${narrow_width}" != "0" ] && [ -z "${verify_out}" ]; then
+		narrow_i="${folder_path}/${filename}_narrow.i"
+		narrow_c="${folder_path}/${filename}_narrow.c"
+		prepare_input "${narrow_i}" -D "SEU_BIT_MAX=$((narrow_width - 1))"
+		./narrow_width -width "${narrow_width}" "${narrow_i}" "${narrow_c}"
+		narrow_out=$(/home/opam/demo/verify_crv.sh "${narrow_c}" "${screen_args[@]}")
+		if grep -q -x "VERDICT: CRV" <<< "${narrow_out}"; then
+			verify_out="${narrow_out}"
+			sed -i 's/ SUCCESS$/ UNKNOWN/' "${folder_path}/${filename}_properties.txt"
+			echo "[+] ${vars[$i]}: CRV at ${narrow_width} bits"
+		else
+			echo "[+] ${vars[$i]}: no CRV at ${narrow_width} bits, verifying at full width"
+		fi
+	fi
+	if [ "${goto_cache}" = "1" ] && [ -z "${verify_out}" ]; then
+		prime_gb="${folder_path}/${filename}_prime.gb"
+		linked_gb="${folder_path}/${filename}_linked.gb"
+		if goto-cc -c "${folder_path}/${filename}_instru_cleaned.c" -o "${prime_gb}" > "${prime_gb}.log" 2>&1 \
+			&& goto-cc "${harness_gb}" "${prime_gb}" -o "${linked_gb}" > "${linked_gb}.log" 2>&1; then
+			verify_args+=(--source "${verify_input}")
+			verify_input="${linked_gb}"
+		else
+			echo "[-] ${vars[$i]}: goto-cc compile/link failed (see ${folder_path}/*.gb.log), verifying the C file instead"
+		fi
+	fi
+	if [ "${static_full}" = "1" ] && [ -z "${verify_out}" ]; then
+		static_i="${folder_path}/${filename}_static.i"
+		prepare_input "${static_i}"
+		verify_args+=(--source "${verify_input}")
+		verify_input="${static_i}"
+	fi
+	if [ -z "${verify_out}" ]; then
+		verify_out=$(/home/opam/demo/verify_crv.sh "${verify_input}" "${verify_args[@]}")
+	fi
+	verdict=$(sed -n 's/^VERDICT: //p' <<< "${verify_out}")
+	flip_index=$(sed -n 's/^FLIP INDEX: //p' <<< "${verify_out}")		#Element found relevant, "[?]" targets only.
+	printf "vars[%d] = %s : %s%s\n" "$i" "${vars[$i]}" "${verdict:-UNKNOWN}" "${flip_index:+ (index ${flip_index})}" >> "$crv_results_txt"
+	echo "[+] ${vars[$i]}: ${verdict:-UNKNOWN}${flip_index:+ (index ${flip_index})}"
+	awk -v var="${vars[$i]}" '{ print var, $1, $2 }' "${folder_path}/${filename}_properties.txt" >> "$tmp_properties_txt"
 done
+echo "CRV verdicts written to: ${crv_results_txt}"
+
+#Variable x invariant relevance matrix: X = the flip violates that invariant, - = it can't, ? = unknown.
+awk '
+  !($1 in seen_var) { seen_var[$1] = 1; var_order[++nvars] = $1 }
+  !($2 in seen_prop) { seen_prop[$2] = 1; prop_order[++nprops] = $2 }
+  { cell[$1, $2] = ($3 == "FAILURE") ? "X" : (($3 == "SUCCESS") ? "-" : "?") }
+  END {
+    printf "%-24s", "variable"
+    for (p = 1; p <= nprops; p++) printf " %s", prop_order[p]
+    printf "\n"
+    for (v = 1; v <= nvars; v++) {
+      printf "%-24s", var_order[v]
+      for (p = 1; p <= nprops; p++) {
+        c = ((var_order[v], prop_order[p]) in cell) ? cell[var_order[v], prop_order[p]] : "?"
+        printf " %*s", length(prop_order[p]), c
+      }
+      printf "\n"
+    }
+  }
+' "$tmp_properties_txt" > "$crv_matrix_txt"
+rm -f "$tmp_properties_txt"
+echo "Relevance matrix written to: ${crv_matrix_txt}"
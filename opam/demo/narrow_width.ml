@@ -0,0 +1,223 @@
+open Cil
+module E = Errormsg
+
+(* Reduced-width screening of a CBMC ready product program (preprocessed, with SEU_BIT_MAX = width - 1).
+   The int and unsigned int variables of the program itself (not those of the headers) whose address isn't taken
+   and whose constants (assigned, compared with, initializers) all fit are re-typed to a 'width' bit type
+   (16: short, 8: signed char, unsigned alike), so that cbmc works on narrower bitvectors. Every execution left
+   is one of the full-width program:
+     - every read of a narrowed variable is cast back to its original type, so expressions compute as before;
+     - every conversion into a narrowed variable (assignment, call result, argument of a narrowed formal) is
+       preceded by __CPROVER_assume(the value fits), which cuts the executions where the narrow type would lose it;
+     - the flips of a narrowed variable go through simulate_seu_main_sized(), and SEU_BIT_MAX = width - 1 keeps the
+       narrow sign bit, whose flip doesn't change the value as it does at full width, out of reach;
+     - bit positions count from 1 (the least significant bit) in simulate_seu() and simulate_seu_main_sized()
+       alike, so position b flips bit b - 1 at either width: below the narrow sign bit, the two's complement
+       bits of a value that fits are the same, and the flip changes it by the same amount as at full width.
+   So a CRV found at the narrow width is a CRV at full width. A NOT_CRV only covers the inputs that fit and the low
+   bits, and is left to the full-width run. *)
+
+let width = ref 16
+
+let narrow_kind (k : ikind) : ikind =
+  match k, !width with
+  | IInt, 8 -> ISChar
+  | IUInt, 8 -> IUChar
+  | IInt, _ -> IShort
+  | IUInt, _ -> IUShort
+  | k, _ -> k
+
+(* Values of the narrow type of an int (IInt) or unsigned int (IUInt) variable *)
+let bounds (k : ikind) : int64 * int64 =
+  match k with
+  | IUInt -> (0L, Int64.sub (Int64.shift_left 1L !width) 1L)
+  | _ -> (Int64.neg (Int64.shift_left 1L (!width - 1)), Int64.sub (Int64.shift_left 1L (!width - 1)) 1L)
+
+let fits (k : ikind) (c : int64) : bool =
+  let (lo, hi) = bounds k in
+  Int64.compare lo c <= 0 && Int64.compare c hi <= 0
+
+let int_kind (t : typ) : (ikind * attributes) option =
+  match unrollType t with
+  | TInt ((IInt | IUInt) as k, a) -> Some (k, a)
+  | _ -> None
+
+let in_source (loc : location) : bool = not (Filename.check_suffix loc.file ".h")
+
+let rec strip_casts = function
+  | CastE (_, e) -> strip_casts e
+  | e -> e
+
+(* simulate_seu_main(&x): the one place where taking the address of a narrowed variable is fine *)
+let is_seu_flip (f : varinfo) (args : exp list) : bool =
+  f.vname = "simulate_seu_main" &&
+  (match List.map strip_casts args with [AddrOf (Var _, NoOffset)] -> true | _ -> false)
+
+(* -------------------------------------------------- *)
+(* Which variables can be narrowed                    *)
+(* -------------------------------------------------- *)
+(* Marks the int variables that can't be narrowed (address taken, a constant out of the narrow range) and
+   the functions whose address is taken (their formals keep their type, calls through pointers aren't seen) *)
+class scanVisitor (excluded : (int, unit) Hashtbl.t) (fun_refs : (string, unit) Hashtbl.t) = object (self)
+  inherit nopCilVisitor
+
+  method private check (e : exp) (c : exp) =
+    match strip_casts e, isInteger (constFold true c) with
+    | Lval (Var vi, NoOffset), Some v ->
+        (match int_kind vi.vtype with
+         | Some (k, _) when not (fits k v) -> Hashtbl.replace excluded vi.vid ()
+         | _ -> ())
+    | _ -> ()
+
+  method vinst (i : instr) =
+    match i with
+    | Set ((Var _, NoOffset) as lv, e, _) -> self#check (Lval lv) e; DoChildren
+    | Call (ret, Lval (Var f, NoOffset), args, _) ->
+        (match ret with Some lv -> ignore (visitCilLval (self :> cilVisitor) lv) | None -> ());
+        if not (is_seu_flip f args) then List.iter (fun a -> ignore (visitCilExpr (self :> cilVisitor) a)) args;
+        SkipChildren
+    | _ -> DoChildren
+
+  method vexpr (e : exp) =
+    (match e with
+     | AddrOf (Var vi, _) | StartOf (Var vi, _) ->
+         Hashtbl.replace excluded vi.vid ();
+         if isFunctionType vi.vtype then Hashtbl.replace fun_refs vi.vname ()
+     | Lval (Var vi, NoOffset) when isFunctionType vi.vtype -> Hashtbl.replace fun_refs vi.vname ()
+     | BinOp ((Lt | Gt | Le | Ge | Eq | Ne), e1, e2, _) -> self#check e1 e2; self#check e2 e1
+     | _ -> ());
+    DoChildren
+end
+
+(* -------------------------------------------------- *)
+(* Narrowed program                                   *)
+(* -------------------------------------------------- *)
+(* lo <= e && e <= hi for the narrow type of a variable of type orig *)
+let in_range (orig : typ) (e : exp) : exp =
+  let (lo, hi) = bounds (match int_kind orig with Some (k, _) -> k | None -> IInt) in
+  BinOp (LAnd, BinOp (Le, kinteger64 IInt lo, e, intType), BinOp (Le, e, kinteger64 IInt hi, intType), intType)
+
+class narrowVisitor (file : file) (narrowed : (int, typ) Hashtbl.t) (fundecs : (string, fundec) Hashtbl.t)
+    (fd : fundec) = object (self)
+  inherit nopCilVisitor
+
+  (* Whether storing e into the narrowed variable vi can lose its value *)
+  method private needs_check (vi : varinfo) (e : exp) : bool =
+    match isInteger (constFold true e), e with
+    | Some c, _ ->
+        not (fits (match int_kind (Hashtbl.find narrowed vi.vid) with Some (k, _) -> k | None -> IInt) c)
+    | None, Lval (Var v, NoOffset) -> not (Hashtbl.mem narrowed v.vid && typeSig v.vtype = typeSig vi.vtype)
+    | None, _ -> true
+
+  method private assume (vi : varinfo) (e : exp) (loc : location) : instr =
+    let assume_fun = findOrCreateFunc file "__CPROVER_assume"
+      (TFun (voidType, Some [("cond", intType, [])], false, [])) in
+    Call (None, Lval (Var assume_fun, NoOffset), [in_range (Hashtbl.find narrowed vi.vid) e], loc)
+
+  method vexpr (e : exp) =
+    match e with
+    | Lval (Var vi, NoOffset) when Hashtbl.mem narrowed vi.vid ->
+        ChangeTo (CastE (Hashtbl.find narrowed vi.vid, e))
+    | _ -> DoChildren
+
+  method vinst (i : instr) =
+    match i with
+    | Set ((Var vi, NoOffset), e, loc) when Hashtbl.mem narrowed vi.vid && self#needs_check vi e ->
+        ChangeDoChildrenPost ([self#assume vi e loc; i], fun il -> il)
+    | Call (None, Lval (Var f, NoOffset), [a], loc) when is_seu_flip f [a] ->
+        (match strip_casts a with
+         | AddrOf (Var vi, NoOffset) when Hashtbl.mem narrowed vi.vid ->
+             let sized = findOrCreateFunc file "simulate_seu_main_sized"
+               (TFun (voidType, Some [("arg", voidPtrType, []); ("size", uintType, [])], false, [])) in
+             ChangeTo [Call (None, Lval (Var sized, NoOffset),
+                             [mkCast (AddrOf (Var vi, NoOffset)) voidPtrType; SizeOf vi.vtype], loc)]
+         | _ -> SkipChildren)
+    | Call (ret, fn, args, loc) ->
+        (* Arguments of narrowed formals *)
+        let rec checks formals args =
+          match formals, args with
+          | v :: fs, a :: rest ->
+              let c = checks fs rest in
+              if Hashtbl.mem narrowed v.vid && self#needs_check v a then self#assume v a loc :: c else c
+          | _ -> []
+        in
+        let pre =
+          match fn with
+          | Lval (Var f, NoOffset) when Hashtbl.mem fundecs f.vname -> checks (Hashtbl.find fundecs f.vname).sformals args
+          | _ -> []
+        in
+        (* A narrowed result goes through a temporary of the return type *)
+        (match ret with
+         | Some (Var vi, NoOffset) when Hashtbl.mem narrowed vi.vid ->
+             let rt = match unrollType (typeOf fn) with TFun (rt, _, _, _) -> rt | _ -> intType in
+             let tmp = makeTempVar fd ~name:"narrow_ret" rt in
+             ChangeDoChildrenPost (pre @ [Call (Some (Var tmp, NoOffset), fn, args, loc);
+                                          self#assume vi (Lval (Var tmp, NoOffset)) loc;
+                                          Set ((Var vi, NoOffset), Lval (Var tmp, NoOffset), loc)], fun il -> il)
+         | _ when pre <> [] -> ChangeDoChildrenPost (pre @ [i], fun il -> il)
+         | _ -> DoChildren)
+    | _ -> DoChildren
+end
+
+let () =
+  let rec options = function
+    | "-width" :: w :: rest ->
+        width := (try int_of_string w with Failure _ -> 0);
+        if !width <> 8 && !width <> 16 then begin
+          Printf.eprintf "Invalid width '%s', use 8 or 16\n" w;
+          exit 1
+        end;
+        options rest
+    | [input_file; output_file] -> (input_file, output_file)
+    | _ ->
+        Printf.eprintf "Usage: %s [-width 8|16] <cbmc_ready.i> <output_file>\n" Sys.argv.(0);
+        exit 1
+  in
+  let (input_file, output_file) = options (List.tl (Array.to_list Sys.argv)) in
+  let f = Frontc.parse input_file () in
+
+  let excluded = Hashtbl.create 17 in
+  let fun_refs = Hashtbl.create 17 in
+  visitCilFileSameGlobals (new scanVisitor excluded fun_refs) f;
+  iterGlobals f (function
+    | GVar (vi, { init = Some (SingleInit e) }, _) ->
+        (match int_kind vi.vtype, isInteger (constFold true e) with
+         | Some (k, _), Some c when not (fits k c) -> Hashtbl.replace excluded vi.vid ()
+         | _ -> ())
+    | _ -> ());
+
+  (* Re-typing: globals and locals of the program, and the formals of the functions only called directly *)
+  let narrowed = Hashtbl.create 17 in
+  let names = ref [] in
+  let narrow vi =
+    match int_kind vi.vtype with
+    | Some (k, a) when not (Hashtbl.mem excluded vi.vid) ->
+        Hashtbl.replace narrowed vi.vid vi.vtype;
+        vi.vtype <- TInt (narrow_kind k, a);
+        names := vi.vname :: !names
+    | _ -> ()
+  in
+  let fundecs = Hashtbl.create 17 in
+  iterGlobals f (function
+    | GVar (vi, _, loc) when in_source loc -> narrow vi
+    | GFun (fd, loc) when in_source loc ->
+        List.iter narrow fd.slocals;
+        if fd.svar.vname <> "main" && not (Hashtbl.mem fun_refs fd.svar.vname) then begin
+          List.iter narrow fd.sformals;
+          setFormals fd fd.sformals;
+          Hashtbl.replace fundecs fd.svar.vname fd
+        end
+    | _ -> ());
+
+  iterGlobals f (function
+    | GFun (fd, _) -> ignore (visitCilFunction (new narrowVisitor f narrowed fundecs fd) fd)
+    | _ -> ());
+  (* cbmc knows its builtins, the implicit declarations CIL made for them would clash *)
+  f.globals <- List.filter (function
+    | GVarDecl (vi, _) -> not (String.length vi.vname > 10 && String.sub vi.vname 0 10 = "__CPROVER_")
+    | _ -> true) f.globals;
+
+  Printf.printf "Narrowed to %d bits: %s\n" !width (String.concat ", " (List.sort compare !names));
+  let out_channel = open_out output_file in
+  dumpFile defaultCilPrinter out_channel output_file f;
+  close_out out_channel
@@ -0,0 +1,90 @@
+#!/bin/bash
+
+#Sound pre-screening of the injected bit positions with Frama-C's Eva, before bounded model checking. Every bit gets one
+#value analysis of the CBMC ready product program, with the flip restricted to that bit (SEU_BIT_MIN = SEU_BIT_MAX), and
+#every SEU_PROPERTY shows the values its condition can take (simulate_seu.h, __FRAMAC__ view):
+#	masked		every property is {1}, or none is reachable: no flip of that bit can violate the safety condition.
+#	relevant	some property is {0} wherever Eva reaches it. Eva can't prove that the point is actually reached, so
+#			these bits still go to CBMC, first.
+#	unknown		anything else, and every bit of a program on which Eva raised an alarm (its paths would be cut).
+#Main's locals are taken as initialized to any value (the nondet inputs) and signed overflows wrap, as in CBMC.
+#
+#Usage: ./prescreen_bits.sh <cbmc_ready.c> [--bits <first>-<last>] [--jobs n] [--out <bits.txt>]
+#Writes one "<bit> <masked|relevant|unknown>" line per bit to the --out file and prints the bits CBMC still has to
+#check as "CHECK BITS: <ranges>" (ex: "1-5,9", relevant ones first, empty when every bit is masked).
+
+input_file="$1"
+first_bit=1
+last_bit=32
+max_jobs=$(nproc)
+bits_out=""
+
+if [ -z "$input_file" ] || [ ! -f "$input_file" ]; then
+	echo "Usage: $0 <cbmc_ready.c> [--bits <first>-<last>] [--jobs n] [--out <bits.txt>]" >&2
+	exit 1
+fi
+shift
+
+while [ $# -gt 0 ]; do
+	case "$1" in
+		--bits)		first_bit="${2%-*}"; last_bit="${2#*-}"; shift 2 ;;
+		--jobs)		max_jobs="$2"; shift 2 ;;
+		--out)		bits_out="$2"; shift 2 ;;
+		*)		echo "Unknown option: $1" >&2; exit 1 ;;
+	esac
+done
+
+work_dir=$(mktemp -d "${TMPDIR:-/tmp}/prescreen_bits.XXXXXX")
+trap 'rm -rf "${work_dir}"' EXIT
+
+
+################# Helpers ###################################################################################################
+#Runs Eva with the flip restricted to one bit.
+eva_bit() {
+	frama-c "$input_file" -cpp-extra-args="-DSEU_BIT_MIN=$1 -DSEU_BIT_MAX=$1" -main main \
+		-eva -eva-initialized-locals -no-warn-signed-overflow > "${work_dir}/eva_$1.log" 2>&1
+}
+
+#Class of one bit from its Eva log.
+classify() {
+	local log="$1"
+	if ! grep -q -E '^\[eva\] Analysis done' "$log" || grep -q -E '^\[eva:alarm\]' "$log"; then
+		echo "unknown"
+		return
+	fi
+	sed -n -E 's/^\[eva\] .*Frama_C_show_each_[A-Za-z0-9_]*: *(.*)$/\1/p' "$log" \
+		| awk '
+			$0 == "{0}" { zero = 1; next }
+			$0 == "{1}" { next }
+			{ other = 1 }
+			END { print zero ? "relevant" : (other ? "unknown" : "masked") }'
+}
+
+#Comma separated ranges of a sorted bit list (ex: 1 2 3 5 -> 1-3,5).
+ranges() {
+	awk '
+		{ if (NR > 1 && $1 == last + 1) { last = $1; next }
+		  if (NR > 1) { out = out sep range(start, last); sep = "," }
+		  start = $1; last = $1 }
+		function range(a, b) { return (a == b) ? a : a "-" b }
+		END { if (NR > 0) out = out sep range(start, last); print out }'
+}
+
+
+################# Eva Runs ##################################################################################################
+echo "[+] Pre-screening bits ${first_bit}-${last_bit} with Eva (${max_jobs} at a time)"
+export -f eva_bit
+export input_file work_dir
+seq "$first_bit" "$last_bit" | xargs -P "$max_jobs" -I{} bash -c 'eva_bit {}'
+
+: > "${work_dir}/bits.txt"
+for ((b = first_bit; b <= last_bit; b++)); do
+	echo "$b $(classify "${work_dir}/eva_${b}.log")" >> "${work_dir}/bits.txt"
+done
+[ -n "$bits_out" ] && cp "${work_dir}/bits.txt" "$bits_out"
+
+masked=$(awk '$2 == "masked"' "${work_dir}/bits.txt" | wc -l)
+echo "[+] ${masked} of $((last_bit - first_bit + 1)) bits masked"
+relevant=$(awk '$2 == "relevant" { print $1 }' "${work_dir}/bits.txt" | ranges)
+unknown=$(awk '$2 == "unknown" { print $1 }' "${work_dir}/bits.txt" | ranges)
+echo "CHECK BITS: ${relevant}${relevant:+${unknown:+,}}${unknown}"
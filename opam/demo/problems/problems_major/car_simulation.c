@@ -5,6 +5,9 @@
 #include <unistd.h>
 #include <math.h>
 
+#define HISTORY_CAPACITY 16  // room for the HISTORY_SIZE-cycle speed window
+#include "/home/opam/demo/window_stats.h"
+
 /* SAFETY CONDITION:
  * 	current speed <= MAX_LEGAL_SPEED
  * &&
@@ -47,8 +50,7 @@ typedef struct Car {
     float acceleration;
     
     // Safety History
-    float speed_history[HISTORY_SIZE];
-    int history_index;
+    WindowStats speed_history;  // last HISTORY_SIZE speeds
     
     // Irrelevant state variables for safety condition
     float tire_pressure[4];
@@ -140,9 +142,9 @@ void init_systems(Car* c, Driver* d) {
     c->gear = 1;
     c->odometer = 0.0f;
     c->fuel_level = 100.0f;
-    c->history_index = 0;
     c->acceleration = 0.0f;
-    for(int i=0; i<HISTORY_SIZE; i++) c->speed_history[i] = 0.0f;
+    initWindowStats(&c->speed_history, HISTORY_SIZE);
+    for(int i=0; i<HISTORY_SIZE; i++) pushWindowStats(&c->speed_history, 0.0f);
 
     // Initialize non-CRVs
     for(int i=0; i<4; i++) c->tire_pressure[i] = 32.0f;
@@ -217,9 +219,8 @@ void update_physics(Car* c, Driver* d) {
 
     if (c->current_speed < 0) c->current_speed = 0;
 
-    // Update History (Circular Buffer)
-    c->speed_history[c->history_index] = c->current_speed;
-    c->history_index = (c->history_index + 1) % HISTORY_SIZE;
+    // Update History (sliding window)
+    pushWindowStats(&c->speed_history, c->current_speed);
 
     // Movement
     c->odometer += (c->current_speed * 0.0001f);
@@ -249,11 +250,7 @@ bool check_safety_protocol(Car* c) {
 
     // Rule 3: Temporal Gear-Speed Constraint
     // Calculate 10-cycle average
-    float sum = 0;
-    for(int i=0; i<HISTORY_SIZE; i++) {
-        sum += c->speed_history[i];
-    }
-    float avg_speed = sum / HISTORY_SIZE;
+    float avg_speed = windowMean(&c->speed_history);
 
     if (avg_speed > 60.0f) {
         if (c->gear < 3) {
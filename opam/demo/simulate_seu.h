@@ -5,8 +5,30 @@
 #include <stdio.h>
 #include <stdbool.h>
 
+// Frama-C (Eva pre-screening of the bits, prescreen_bits.sh): a failed assumption ends the execution.
+#ifdef __FRAMAC__
+#include <stdlib.h>
+#define __CPROVER_assume(cond) do { if (!(cond)) abort(); } while (0)
+#endif
+
 int nondet_int();
 
+// Bit positions an SEU may hit. Overridden with -D to split the bit range over several cbmc runs. By default the only
+// upper bound is the width of the target: 32 for an int, size * 8 for simulate_seu_main_sized().
+#ifndef SEU_BIT_MIN
+#define SEU_BIT_MIN 1
+#endif
+#ifndef SEU_BIT_MAX
+#define SEU_BIT_MAX 0x7fffffff
+#endif
+
+// Input cube of a sub-query (ex: -D 'SEU_CUBE=(x > 10) && !(y == 1)'), assumed right before the entry function call.
+#ifdef SEU_CUBE
+#define SEU_CUBE_ASSUME() __CPROVER_assume(SEU_CUBE)
+#else
+#define SEU_CUBE_ASSUME()
+#endif
+
 // Function to generate a nondeterministic integer within the range [1, 32]
 int nondet_int_range_1_32() {
     int value = nondet_int() % 32 + 1;
@@ -14,19 +36,74 @@ int nondet_int_range_1_32() {
     return value;
 }
 
+// bit_pos counts from 1 (the least significant bit) to 32 (the sign bit), as in simulate_seu_main_sized(), so every
+// position of SEU_BIT_MIN..SEU_BIT_MAX flips a bit of its own.
 int simulate_seu(int value, int bit_pos) {
-    int mask = 1 << bit_pos;
-    __CPROVER_assume(mask >= 1 && mask <= 32);
-    return (value ^ mask); // XOR operation for bit flip
+    __CPROVER_assume(bit_pos >= 1 && bit_pos <= 32);
+    unsigned mask = 1u << (bit_pos - 1);
+    return (int)((unsigned)value ^ mask); // XOR operation for bit flip
 }
 
+// A named safety property of the harness. Every property is reported on its own, so one cbmc run tells which of the
+// invariants a variable is relevant to.
+#ifndef __FRAMAC__
+#define SEU_PROPERTY(name, cond) __CPROVER_assert((cond), #name)
+#else
+// Frama-C: Eva prints the values the condition can take at each property ({1}: holds, {0}: violated, {0; 1}: unknown).
+#define SEU_PROPERTY(name, cond) Frama_C_show_each_##name((int)(cond))
+#endif
+
+// Number of SEUs injected so far, shared by every entry point below: one run flips a single bit, whether the
+// target is reached as an int or through a sized alias in a callee.
+int seu_count = 0;
+
 // Ensures that an SEU is introduced only once for the variable under investigation
 void simulate_seu_main(int *invest_var) {
-    static int count = 0;
-    if(count == 0) {
+    if(seu_count == 0) {
         int bit_pos = nondet_int_range_1_32();
+        __CPROVER_assume(bit_pos >= SEU_BIT_MIN && bit_pos <= SEU_BIT_MAX);
         *invest_var = simulate_seu(*invest_var, bit_pos);
-        count++;
+        seu_count++;
+    }
+}
+
+// Same for a target that isn't an int (a float field, a char array element, ...): flips one bit among the first
+// 'size' bytes of the object. bit_pos counts from 1, the least significant bit of the first byte, and stays within
+// SEU_BIT_MIN..SEU_BIT_MAX (all 64 bits of a double by default).
+void simulate_seu_main_sized(void *invest_var, unsigned size) {
+    if(seu_count == 0) {
+        int bit_pos = nondet_int();
+        __CPROVER_assume(bit_pos >= SEU_BIT_MIN && bit_pos <= SEU_BIT_MAX && bit_pos <= (int)(size * 8));
+        unsigned char *bytes = (unsigned char *)invest_var;
+        bytes[(bit_pos - 1) / 8] ^= (unsigned char)(1u << ((bit_pos - 1) % 8));
+        seu_count++;
+    }
+}
+
+// Element of the array hit by a "[?]" target of instrument_seu: chosen once among the 'length' elements, and only the
+// accesses to that element get the flip, so a single run covers the whole array. A counterexample trace shows the
+// element in its "seu_flip_index=" assignment.
+int seu_flip_index = -1;
+
+bool seu_index_hit(int index, int length) {
+    static int chosen = 0;
+    if(chosen == 0) {
+        seu_flip_index = nondet_int();
+        __CPROVER_assume(seu_flip_index >= 0 && seu_flip_index < length);
+        chosen = 1;
+    }
+    return index == seu_flip_index;
+}
+
+void simulate_seu_main_at(int *invest_var, int index, int length) {
+    if(seu_index_hit(index, length)) {
+        simulate_seu_main(invest_var);
+    }
+}
+
+void simulate_seu_main_sized_at(void *invest_var, unsigned size, int index, int length) {
+    if(seu_index_hit(index, length)) {
+        simulate_seu_main_sized(invest_var, size);
     }
 }
 
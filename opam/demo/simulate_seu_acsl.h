@@ -0,0 +1,24 @@
+#ifndef SIMULATE_SEU_ACSL_H
+#define SIMULATE_SEU_ACSL_H
+
+// Frama-C view of the SEU calls of an instrumented file, for the per-variable re-slice (STEP 5 of
+// manual_run_crv_check.sh). Only the prototypes and what each call may change: a flip changes the
+// target from its own value, so a call is kept exactly when the flipped value can reach the slicing
+// criterion. The definitions stay in simulate_seu.h.
+
+int seu_flip_index;
+
+/*@ assigns *invest_var \from *invest_var; */
+void simulate_seu_main(int *invest_var);
+
+/*@ assigns ((char *)invest_var)[0 .. size - 1] \from ((char *)invest_var)[0 .. size - 1]; */
+void simulate_seu_main_sized(void *invest_var, unsigned size);
+
+/*@ assigns *invest_var, seu_flip_index \from *invest_var, seu_flip_index, index, length; */
+void simulate_seu_main_at(int *invest_var, int index, int length);
+
+/*@ assigns ((char *)invest_var)[0 .. size - 1], seu_flip_index
+      \from ((char *)invest_var)[0 .. size - 1], seu_flip_index, index, length; */
+void simulate_seu_main_sized_at(void *invest_var, unsigned size, int index, int length);
+
+#endif // SIMULATE_SEU_ACSL_H
@@ -0,0 +1,74 @@
+#ifndef TEMPORAL_MONITOR_H
+#define TEMPORAL_MONITOR_H
+
+#include <stdbool.h>
+
+// Constant-state monitors for the window/sequence parts of the safety conditions.
+// Each one is stepped once per cycle with the current sample and answers for the last n samples
+// without keeping them: a saturating counter plus the previous value, no arrays and no loops.
+
+// "cond held on each of the last n steps" (ex: overcurrent for 3 consecutive steps)
+typedef struct {
+    int run;
+} ConsecutiveMonitor;
+
+static inline void initConsecutiveMonitor(ConsecutiveMonitor *m) {
+    m->run = 0;
+}
+
+static inline bool consecutive_step(ConsecutiveMonitor *m, bool cond, int n) {
+    if (!cond) {
+        m->run = 0;
+    } else if (m->run < n) {
+        m->run++;
+    }
+    return m->run >= n;
+}
+
+// "the last n samples are strictly increasing/decreasing" (ex: T0 < T1 < T2 < T3 < T4)
+// Declares the monitor type Name keeping the previous sample as a T, and its init and
+// prefix##increasing_step/prefix##decreasing_step functions. The sample is compared in its own type,
+// so an int or double signal is neither rounded to float nor widened in the formula.
+#define DEFINE_MONOTONIC_MONITOR(Name, T, prefix)                                   \
+typedef struct {                                                                    \
+    T last;                                                                         \
+    int run;                                                                        \
+} Name;                                                                             \
+                                                                                    \
+static inline void init##Name(Name *m) {                                            \
+    m->last = 0;                                                                    \
+    m->run = 0;                                                                     \
+}                                                                                   \
+                                                                                    \
+static inline bool prefix##increasing_step(Name *m, T value, int n) {               \
+    if (m->run > 0 && value > m->last) {                                            \
+        if (m->run < n) {                                                           \
+            m->run++;                                                               \
+        }                                                                           \
+    } else {                                                                        \
+        m->run = 1;                                                                 \
+    }                                                                               \
+    m->last = value;                                                                \
+    return m->run >= n;                                                             \
+}                                                                                   \
+                                                                                    \
+static inline bool prefix##decreasing_step(Name *m, T value, int n) {               \
+    if (m->run > 0 && value < m->last) {                                            \
+        if (m->run < n) {                                                           \
+            m->run++;                                                               \
+        }                                                                           \
+    } else {                                                                        \
+        m->run = 1;                                                                 \
+    }                                                                               \
+    m->last = value;                                                                \
+    return m->run >= n;                                                             \
+}
+
+// The variants compile_safety_cond picks from the type of the monitored expression
+// (int and narrower, wider integers, float, double).
+DEFINE_MONOTONIC_MONITOR(IntMonotonicMonitor, int, int_)
+DEFINE_MONOTONIC_MONITOR(LongMonotonicMonitor, long long, long_)
+DEFINE_MONOTONIC_MONITOR(MonotonicMonitor, float, )
+DEFINE_MONOTONIC_MONITOR(DoubleMonotonicMonitor, double, double_)
+
+#endif // TEMPORAL_MONITOR_H
@@ -0,0 +1,99 @@
+#ifndef WINDOW_STATS_H
+#define WINDOW_STATS_H
+
+#include <stdbool.h>
+#include "history_buffer.h"
+
+// Statistics over the last 'window' samples of a signal (window <= HISTORY_CAPACITY; a file that needs a longer
+// window defines HISTORY_CAPACITY before including this header). A push costs the same for any window:
+//   - sum and mean: added up from the samples in the window, oldest first, each time they are asked for, so no
+//     rounding error carries over from one cycle to the next as it would in a running sum.
+//   - min and max of the samples in the window.
+//   - rising/falling run: length of the current strictly increasing/decreasing run, capped at the window.
+// Sum, mean, min and max walk the HISTORY_CAPACITY slots with the ones outside the window masked out: the loop bound
+// is a constant, so CBMC unrolls it exactly HISTORY_CAPACITY times whatever the samples are. All of them are 0 on an
+// empty window.
+
+typedef struct {
+    FloatHistory samples;
+    unsigned window;
+    bool started;                    // a sample has been pushed
+    float last;
+    unsigned rising_run;
+    unsigned falling_run;
+} WindowStats;
+
+static inline void initWindowStats(WindowStats *w, unsigned window) {
+    initFloatHistory(&w->samples);
+    w->window = (window == 0 || window > HISTORY_CAPACITY) ? HISTORY_CAPACITY : window;
+    w->started = false;
+    w->last = 0.0f;
+    w->rising_run = 0;
+    w->falling_run = 0;
+}
+
+static inline void pushWindowStats(WindowStats *w, float value) {
+    if (w->samples.count == w->window) {
+        popFloatHistory(&w->samples);
+    }
+    pushFloatHistory(&w->samples, value);
+
+    bool rising = w->started && (value > w->last);
+    bool falling = w->started && (value < w->last);
+    w->rising_run = rising ? w->rising_run + (w->rising_run < w->window) : 1u;
+    w->falling_run = falling ? w->falling_run + (w->falling_run < w->window) : 1u;
+    w->last = value;
+    w->started = true;
+}
+
+// Number of samples currently in the window (less than 'window' during the first cycles)
+static inline unsigned windowCount(const WindowStats *w) {
+    return w->samples.count;
+}
+
+static inline float windowSum(const WindowStats *w) {
+    float sum = 0.0f;
+    for (unsigned i = 0; i < HISTORY_CAPACITY; i++) {
+        unsigned age = HISTORY_CAPACITY - 1u - i;
+        if (age < w->samples.count) {
+            sum += getFloatHistory(&w->samples, age);
+        }
+    }
+    return sum;
+}
+
+static inline float windowMean(const WindowStats *w) {
+    return (w->samples.count != 0) ? windowSum(w) / (float)w->samples.count : 0.0f;
+}
+
+static inline float windowMin(const WindowStats *w) {
+    float min = (w->samples.count != 0) ? getFloatHistory(&w->samples, 0) : 0.0f;
+    for (unsigned age = 1; age < HISTORY_CAPACITY; age++) {
+        if (age < w->samples.count && getFloatHistory(&w->samples, age) < min) {
+            min = getFloatHistory(&w->samples, age);
+        }
+    }
+    return min;
+}
+
+static inline float windowMax(const WindowStats *w) {
+    float max = (w->samples.count != 0) ? getFloatHistory(&w->samples, 0) : 0.0f;
+    for (unsigned age = 1; age < HISTORY_CAPACITY; age++) {
+        if (age < w->samples.count && getFloatHistory(&w->samples, age) > max) {
+            max = getFloatHistory(&w->samples, age);
+        }
+    }
+    return max;
+}
+
+// Samples in the current strictly increasing (decreasing) run, the newest included.
+// ex: rising run == window  <=>  the whole window is strictly increasing.
+static inline unsigned windowRisingRun(const WindowStats *w) {
+    return w->rising_run;
+}
+
+static inline unsigned windowFallingRun(const WindowStats *w) {
+    return w->falling_run;
+}
+
+#endif // WINDOW_STATS_H